@@ -1,36 +1,63 @@
 #ifndef AVL_HPP
 #define AVL_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "avl_detail.hpp"
 
 ////////////////////////////// NODE 
 
-template <typename T>
-class Node
+//The number of items in a node's subtree, only kept by order-statistic trees
+template <bool Counted>
+struct SubtreeSize {};
+
+template <>
+struct SubtreeSize<true>
+{
+    size_t count = 1;
+};
+
+template <typename T, bool Counted = false>
+class Node : private SubtreeSize<Counted>
 {
     public:
 
     //////////////// CONSTRUCTORS
 
-    Node() : data(nullptr), left(nullptr), right(nullptr), height(1) {}
+    Node() : data(nullptr), left(nullptr), right(nullptr), parent(nullptr), height(1) {}
 
-    Node(const T& source) : data(nullptr), left(nullptr), right(nullptr), height(1)
+    Node(const T& source, Node* parent = nullptr) : data(nullptr), left(nullptr), right(nullptr), parent(parent), height(1)
     {
         data = new T(source);
     }
 
-    //recursive deallocation of entire tree
+    //deallocation of entire tree, without recursion
     ~Node()
     {
         delete data;
-        delete left;
-        delete right;
+        destroy(left);
+        destroy(right);
 
         data = nullptr;
         left = nullptr;
         right = nullptr;
     }
 
+    //Deletes every node of the subtree at |root|, without recursion or extra memory
+    static void destroy(Node* root)
+    {
+        DestroyLinks links;
+        avl_detail::unwind(links, root);
+    }
+
     //////////////// PUBLIC FUNCTIONS 
 
     Node*& _left()
@@ -43,14 +70,68 @@ class Node
         return right;
     }
 
+    Node*& _parent()
+    {
+        return parent;
+    }
+
+    const T& _data() const
+    {
+        return *data;
+    }
+
+    //Gives up ownership of the data, leaving the node empty
+    T* releaseData()
+    {
+        T* released = data;
+        data = nullptr;
+        return released;
+    }
+
+    //Takes the height and subtree size of |other|, for a node moved into its position
+    void takeShape(const Node& other)
+    {
+        height = other.height;
+        if constexpr (Counted) this->count = other.count;
+    }
+
+    size_t getHeight() const
+    {
+        return height;
+    }
+
+    //The number of items in this node's subtree, 0 unless the node is |Counted|
+    size_t getSize() const
+    {
+        if constexpr (Counted) return this->count;
+        else return 0;
+    }
+
+    //Adds |delta| to the subtree size, for an item added or removed somewhere below
+    void resize(long delta)
+    {
+        if constexpr (Counted) this->count += delta;
+    }
+
+    //Size will be set to one more than the sizes of both subtrees
+    //Called wherever the height is updated
+    void updateSize()
+    {
+        if constexpr (Counted) this->count = 1 + _size(left) + _size(right);
+    }
+
+    //The adopted child's parent is set to this node
     void setLeft(Node*& _left)
     {
         left = _left;
+        if (left) left->parent = this;
     }
 
+    //The adopted child's parent is set to this node
     void setRight(Node*& _right)
     {
         right = _right;
+        if (right) right->parent = this;
     }
 
     //True if |other| is less than |data|
@@ -88,6 +169,18 @@ class Node
         return false;
     }
 
+    //True if the left subtree is taller than the right subtree
+    bool isLeftHeavy() const
+    {
+        return _height(left) > _height(right);
+    }
+
+    //True if the right subtree is taller than the left subtree
+    bool isRightHeavy() const
+    {
+        return _height(right) > _height(left);
+    }
+
     void display(std::ostream& out) const
     {
         if (data) out << *data;
@@ -107,6 +200,10 @@ class Node
     //The right child of this node
     Node* right;
 
+    //The parent of this node, null for the root
+    //Lets iterators step to the in-order neighbour without a stack
+    Node* parent;
+
     //The height of this node
     //A leaf has a height of 1
     size_t height;
@@ -115,218 +212,1400 @@ class Node
 
     //Return the height of the passed |root|
     //0 if |root| is null
-    static size_t _height(Node<T>* root)
+    static size_t _height(Node* root)
     {
         return root ? root->height : 0;
     }
+
+    //Return the subtree size of the passed |root|
+    //0 if |root| is null
+    static size_t _size(Node* root)
+    {
+        return root ? root->getSize() : 0;
+    }
+
+    //The child links as avl_detail::unwind reads them
+    //A node's right link is cleared before it is deleted, its destructor has nothing left to free
+    struct DestroyLinks
+    {
+        Node* left(Node* node) const { return node->left; }
+        Node* right(Node* node) const { return node->right; }
+
+        void setLeft(Node* node, Node* child) { node->left = child; }
+        void setRight(Node* node, Node* child) { node->right = child; }
+
+        void release(Node* node)
+        {
+            node->right = nullptr;
+            delete node;
+        }
+    };
+};
+
+////////////////////////////// INSTRUMENTATION
+
+//The four rebalancing cases, named by the path from the unbalanced node to the taller grandchild
+enum class Rotation
+{
+    LeftLeft,   //a single right rotation
+    LeftRight,  //a left rotation of the left child, then a right rotation
+    RightLeft,  //a right rotation of the right child, then a left rotation
+    RightRight  //a single left rotation
+};
+
+inline const char* rotationName(Rotation rotation)
+{
+    switch (rotation)
+    {
+        case Rotation::LeftLeft: return "LEFT LEFT";
+        case Rotation::LeftRight: return "LEFT RIGHT";
+        case Rotation::RightLeft: return "RIGHT LEFT";
+        default: return "RIGHT RIGHT";
+    }
+}
+
+/*
+An instrumentation policy receives a call at each of these points of the tree's work :
+
+    comparison()          : two items were ordered
+    allocation()          : a node was allocated
+    depth(d)              : a node was placed at depth |d|, the root being at depth 1
+    imbalance(node)       : |node| was found unbalanced
+    rotation(rotation)    : |node| was rebalanced with the given case
+
+The hooks are resolved at compile time, the default policy's are empty and inline to nothing.
+Lookups are const and may run on several threads at once, each calling comparison() on the same
+policy, so a policy keeping state must be safe to call concurrently.
+*/
+
+//Does nothing, the default
+struct NoInstrumentation
+{
+    void comparison() {}
+    void allocation() {}
+    void depth(size_t) {}
+
+    template <typename N>
+    void imbalance(const N&) {}
+
+    void rotation(Rotation) {}
+};
+
+//A counter concurrent lookups can update, relaxed as only the totals are ever read
+//Reads as a plain size_t, and copies take a snapshot of the count
+class Tally
+{
+    public:
+
+    Tally(size_t value = 0) : value(value) {}
+
+    Tally(const Tally& other) : value(size_t(other)) {}
+
+    Tally& operator=(const Tally& other)
+    {
+        value.store(size_t(other), std::memory_order_relaxed);
+        return *this;
+    }
+
+    operator size_t() const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    Tally& operator++()
+    {
+        value.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    //Raises the count to |candidate| if it is larger
+    void raise(size_t candidate)
+    {
+        size_t current = value.load(std::memory_order_relaxed);
+        while (current < candidate && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed));
+    }
+
+    private:
+
+    std::atomic<size_t> value;
+};
+
+//Tallies the tree's work, for metrics
+struct CountingInstrumentation
+{
+    //Rotations performed, indexed by Rotation
+    Tally rotations[4] = {};
+
+    Tally comparisons = 0;
+    Tally allocations = 0;
+
+    //The deepest a node was ever placed
+    Tally maxDepth = 0;
+
+    void comparison() { ++comparisons; }
+    void allocation() { ++allocations; }
+    void depth(size_t d) { maxDepth.raise(d); }
+
+    template <typename N>
+    void imbalance(const N&) {}
+
+    void rotation(Rotation rotation) { ++rotations[static_cast<size_t>(rotation)]; }
+
+    //The number of rebalances of any case
+    size_t totalRotations() const
+    {
+        return rotations[0] + rotations[1] + rotations[2] + rotations[3];
+    }
+
+    void reset()
+    {
+        *this = CountingInstrumentation();
+    }
+};
+
+//Writes every imbalance and the rotation fixing it to a stream, for debugging
+struct TracingInstrumentation
+{
+    std::ostream* out;
+
+    explicit TracingInstrumentation(std::ostream& out = std::clog) : out(&out) {}
+
+    void comparison() {}
+    void allocation() {}
+    void depth(size_t) {}
+
+    template <typename N>
+    void imbalance(const N& node)
+    {
+        *out << "\nIMBALANCE FOUND : ";
+        node.display(*out);
+        *out << '\n';
+    }
+
+    void rotation(Rotation rotation)
+    {
+        *out << rotationName(rotation) << " IMBALANCE\n";
+    }
 };
 
 ////////////////////////////// AVL TREE 
 
-template <typename T>
+/*
+With |OrderStatistics| set, every node also counts the items of its subtree, which adds a size_t
+per node. Rank, select, count and split need those counts and are only available with it, all
+O(log N). Insert, erase, join and the rotations maintain the counts.
+*/
+
+template <typename T, typename Instrument = NoInstrumentation, bool OrderStatistics = false>
 class AvlTree
 {
+    using NodeT = Node<T, OrderStatistics>;
+
     public:
 
+    //////////////// ITERATOR
+
+    //Walks the tree in order, both ways, through the parent links
+    //Stepping is O(1) amortized, so a range of k items after a lookup costs O(log N + k)
+    //The items are the keys of the tree and are never mutable
+    class const_iterator
+    {
+        friend class AvlTree;
+
+        public:
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : node(nullptr), tree(nullptr) {}
+
+        reference operator*() const
+        {
+            return node->_data();
+        }
+
+        pointer operator->() const
+        {
+            return &node->_data();
+        }
+
+        const_iterator& operator++()
+        {
+            node = successor(node);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        //Decrementing end() moves to the largest item
+        const_iterator& operator--()
+        {
+            node = node ? predecessor(node) : rightmost(tree->root);
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return node == other.node;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return node != other.node;
+        }
+
+        private:
+
+        //The current node, null past the end
+        NodeT* node;
+
+        //The tree walked, needed to step back from end()
+        const AvlTree* tree;
+
+        const_iterator(NodeT* node, const AvlTree* tree) : node(node), tree(tree) {}
+    };
+
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
     //////////////// CONSTRUCTORS
 
     AvlTree() : root(nullptr), dataCount(0) {}
 
+    //Uses the given |instrument|, for policies holding settings such as an output stream
+    explicit AvlTree(const Instrument& instrument) : root(nullptr), dataCount(0), instrument(instrument) {}
+
+    //Takes over the nodes of |other|, leaving it empty
+    AvlTree(AvlTree&& other) noexcept : root(other.root), dataCount(other.dataCount), instrument(std::move(other.instrument))
+    {
+        other.root = nullptr;
+        other.dataCount = 0;
+    }
+
+    AvlTree& operator=(AvlTree&& other) noexcept
+    {
+        if (this == &other) return *this;
+
+        clear();
+
+        root = other.root;
+        dataCount = other.dataCount;
+        instrument = std::move(other.instrument);
+
+        other.root = nullptr;
+        other.dataCount = 0;
+
+        return *this;
+    }
+
+    //Nodes are owned by a single tree
+    AvlTree(const AvlTree&) = delete;
+    AvlTree& operator=(const AvlTree&) = delete;
+
     ~AvlTree()
     {
-        delete root;
+        clear();
     }
 
-    //////////////// PUBLIC FUNCTIONS 
+    //////////////// BULK LOADING
 
-    void insert(const T& data)
+    //Builds a perfectly balanced tree from |items|, which must already be sorted, in O(N)
+    //Every node is placed once, no comparison or rotation is made
+    template <typename Range>
+    static AvlTree from_sorted(const Range& items, const Instrument& instrument = Instrument())
     {
-        insert(data, root);
+        AvlTree tree(instrument);
+
+        auto next = std::begin(items);
+        size_t count = std::distance(std::begin(items), std::end(items));
+
+        tree.root = tree.build(next, count);
+        tree.dataCount = count;
+
+        return tree;
     }
 
-    void display(std::ostream& out = std::cout) const
+    //Builds a tree from |items| in any order, sorting a copy of them first in O(N log N)
+    //Large inputs are sorted in |threads| parallel runs that are then merged pairwise
+    template <typename Range>
+    static AvlTree from_unsorted(const Range& items, size_t threads = std::thread::hardware_concurrency(),
+                                 const Instrument& instrument = Instrument())
     {
-        display(root, out);
+        std::vector<T> sorted(std::begin(items), std::end(items));
+        sort(sorted, threads);
+
+        return from_sorted(sorted, instrument);
     }
 
-    void debugDisplay() const
+    //////////////// JOIN-BASED OPERATIONS
+    //Built on join, which links two trees and a middle node in O(|height difference|) (Blelloch,
+    //Ferizovic and Sun, "Just Join for Parallel Ordered Sets"). The trees passed in are consumed,
+    //their nodes are moved into the result without copying any item.
+
+    //Joins two trees where no item of |left| is greater than an item of |right|, in O(log N)
+    static AvlTree join(AvlTree&& left, AvlTree&& right)
     {
-        if (!root) return;
+        AvlTree joined(std::move(left));
 
-        std::cout << "\nROOT   : ";
-        root->display(std::cout);
-        std::cout << '\n';
+        joined.root = join2(joined.root, right.root);
+        joined.dataCount += right.dataCount;
 
-        debugDisplay(root);
+        right.root = nullptr;
+        right.dataCount = 0;
+
+        return joined;
     }
 
-    private:
+    //Splits the tree into the items less than |key| and the rest, leaving it empty
+    //Only available with |OrderStatistics| set, the subtree counts give the size of each part in O(1)
+    template <typename K>
+    std::pair<AvlTree, AvlTree> split(const K& key)
+    {
+        static_assert(OrderStatistics, "split needs an AvlTree with OrderStatistics");
 
-    //////////////// DATA 
+        std::pair<AvlTree, AvlTree> parts{ AvlTree(instrument), AvlTree(instrument) };
 
-    //The root node of the tree
-    Node<T>* root;
+        splitLess(root, key, parts.first.root, parts.second.root);
 
-    //The number of items in the tree
-    size_t dataCount;
+        parts.first.dataCount = size(parts.first.root);
+        parts.second.dataCount = dataCount - parts.first.dataCount;
 
-    //////////////// PRIVATE FUNCTIONS 
+        root = nullptr;
+        dataCount = 0;
+
+        return parts;
+    }
 
-    void insert(const T& data, Node<T>*& root)
+    /*
+    The set operations treat both trees as sets, each must hold distinct items. They run in
+    O(m log(n / m + 1)) work for trees of m <= n items, and the two halves of every step run as
+    parallel tasks while the subtrees are large and fewer than |threads| tasks are running.
+    They count the nodes they delete instead of the sizes of the parts they split, so the bound
+    holds without |OrderStatistics|.
+    */
+
+    //The items of either tree, an item of |b| equal to one of |a| is dropped
+    static AvlTree setUnion(AvlTree&& a, AvlTree&& b, size_t threads = std::thread::hardware_concurrency())
     {
-        if (!root)
-        {
-            root = new Node<T>(data);
-            ++dataCount;
-            return;
-        }
+        return combine(std::move(a), std::move(b), threads, unite);
+    }
+
+    //The items of |a| equal to an item of |b|
+    static AvlTree setIntersection(AvlTree&& a, AvlTree&& b, size_t threads = std::thread::hardware_concurrency())
+    {
+        return combine(std::move(a), std::move(b), threads, intersect);
+    }
+
+    //The items of |a| not equal to any item of |b|
+    static AvlTree setDifference(AvlTree&& a, AvlTree&& b, size_t threads = std::thread::hardware_concurrency())
+    {
+        return combine(std::move(a), std::move(b), threads, subtract);
+    }
+
+    //////////////// PUBLIC FUNCTIONS 
+
+    //Descends to the new leaf recording the links taken, then retraces them bottom-up
+    //Retracing stops at the first subtree whose height is unchanged, or after the single
+    //rebalance an insert can need, as either leaves every height above it unchanged
+    void insert(const T& data)
+    {
+        //The links from the root down to the new leaf
+        NodeT** path[MAX_HEIGHT];
+        size_t depth = 0;
 
-        //Will be set to true if :
-        // a) The root's left child has a left subtree imbalance
-        // b) The root's right child has a left subtree imbalance
-        bool hasLeftImbalance = false;
+        NodeT** link = &root;
+        NodeT* parent = nullptr;
 
-        //If |data| is less than the root's data, traverse left
-        if (root->lessThan(data))
+        while (*link)
         {
-            insert(data, root->_left());
+            path[depth++] = link;
+            parent = *link;
 
-            //Update the subtree height
-            root->updateHeight();
+            //Every node passed gains an item below it, whether or not retracing reaches it
+            parent->resize(1);
 
-            if (root->isUnbalanced(hasLeftImbalance))
-            {
-                std::cout << "\n\nIMBALANCE FOUND\n\n";
-                root->display(std::cout);
-
-                //1) The root's left child has a left subtree imbalance
-                if (hasLeftImbalance)
-                {
-                    std::cout << "\nLEFT IMBALANCE\n\n";
-                    rotateRight(root);
-                }
-
-                //2) The root's left child has a right subtree imbalance
-                else
-                {
-                    std::cout << "\nRIGHT IMBALANCE\n\n";
-                    rotateLeft(root->_left());
-                    rotateRight(root);
-                }
-            }
+            instrument.comparison();
+
+            //If |data| is less than the parent's data, traverse left, otherwise traverse right
+            link = parent->lessThan(data) ? &parent->_left() : &parent->_right();
         }
 
-        //|data| is larger than or equal to root's data, traverse right
-        else
+        *link = new NodeT(data, parent);
+        ++dataCount;
+
+        instrument.allocation();
+        instrument.depth(depth + 1);
+
+        while (depth)
         {
-            insert(data, root->_right());
+            NodeT*& node = *path[--depth];
+
+            size_t previousHeight = node->getHeight();
+            node->updateHeight();
 
-            //Update the subtree height
-            root->updateHeight();
+            //Will be set to true if the left subtree is the taller one
+            bool hasLeftImbalance = false;
 
-            if (root->isUnbalanced(hasLeftImbalance))
+            if (node->isUnbalanced(hasLeftImbalance))
             {
-                std::cout << "\n\nIMBALANCE FOUND\n\n";
-                root->display(std::cout);
-
-                //3) The root's right child has a left subtree imbalance
-                if (hasLeftImbalance)
-                {
-                    std::cout << "\nLEFT IMBALANCE\n\n";
-                    rotateRight(root->_right());
-                    rotateLeft(root);
-                }
-
-                //4) The root's right child has a right subtree imbalance
-                else
-                {
-                    std::cout << "\nRIGHT IMBALANCE\n\n";
-                    rotateLeft(root);
-                }
+                instrument.imbalance(*node);
+                rebalance(node, hasLeftImbalance);
+                return;
             }
+
+            if (node->getHeight() == previousHeight) return;
         }
     }
 
-    //////////////// BALANCING ROTATIONS 
+    //The instrumentation policy, holding whatever it recorded
+    const Instrument& instrumentation() const
+    {
+        return instrument;
+    }
 
-    static void rotateRight(Node<T>*& root)
+    Instrument& instrumentation()
     {
-        //Hold onto the old root
-        Node<T>* oldRoot = root;
+        return instrument;
+    }
 
-        //Set the left child to be the new root
-        root = root->_left();
+    //The number of items in the tree
+    size_t size() const
+    {
+        return dataCount;
+    }
 
-        //Set the old root's left to the new root's right subtree (null possiblity)
-        oldRoot->setLeft(root->_right());
-        
-        //Adopt |oldRoot| as right subtree
-        root->setRight(oldRoot);
-        //root->setLeft(root);
+    //True if the tree holds no items
+    bool empty() const
+    {
+        return !root;
+    }
 
-        //Update the node heights
-        oldRoot->updateHeight();
-        root->updateHeight();
+    //////////////// REMOVAL
+
+    //Removes the item at |position| in O(log N)
+    //Returns the position of the item that followed it
+    //Only iterators to the removed item are invalidated
+    const_iterator erase(const_iterator position)
+    {
+        NodeT* next = nullptr;
+        NodeT* removed = unlink(position.node, next);
+
+        delete removed;
+
+        return const_iterator(next, this);
     }
 
-    static void rotateLeft(Node<T>*& root)
+    //Removes every item equal to |key|
+    //Returns the number of items removed
+    template <typename K>
+    size_t erase(const K& key)
     {
-        //Hold onto the old root
-        Node<T>* oldRoot = root;
+        size_t removed = 0;
 
-        //Set the right child to be the new root
-        root = root->_right();
+        for (const_iterator found = find(key); found != end() && !(key < *found); ++removed)
+            found = erase(found);
 
-        //Set the old root's right to the new root's left subtree (null possiblity)
-        oldRoot->setRight(root->_left());
-        
-        //Adopt |oldRoot| as right subtree
-        root->setLeft(oldRoot);
+        return removed;
+    }
 
-        //Update the node heights
-        oldRoot->updateHeight();
-        root->updateHeight();
+    //Removes the item at |position| and hands it back without copying it
+    T extract(const_iterator position)
+    {
+        NodeT* next = nullptr;
+        NodeT* removed = unlink(position.node, next);
+
+        T* data = removed->releaseData();
+        T item(std::move(*data));
+
+        delete data;
+        delete removed;
+
+        return item;
     }
 
-    static void display(Node<T>* root, std::ostream& out)
+    //Removes the first item equal to |key| and hands it back
+    //Returns an empty optional if there is none
+    template <typename K>
+    std::optional<T> extract(const K& key)
     {
-        if (!root) return;
+        const_iterator found = find(key);
 
-        display(root->_left(), out);
-        root->display(out);
-        display(root->_right(), out);
+        if (found == end()) return std::nullopt;
+        return extract(found);
     }
 
-    static void debugDisplay(Node<T>* root, size_t level = 1)
+    //Removes every item, without recursion
+    void clear()
     {
-        if (!root) return;
-        if (root->isLeaf()) return;
+        NodeT::destroy(root);
 
-        std::cout << "LVL " << level;
+        root = nullptr;
+        dataCount = 0;
+    }
 
-        if (level < 10) std::cout << "  : ";
-        else std::cout << " : ";
+    //////////////// LOOKUP
+    //|key| may be of any type ordered against T with <, in both directions
 
-        //True if a left item was displayed
-        bool left = false;
+    //The first item that is not less than |key|, end() if there is none
+    template <typename K>
+    const_iterator lower_bound(const K& key) const
+    {
+        NodeT* found = nullptr;
 
-        if (root->_left())
+        for (NodeT* current = root; current;)
         {
-            left = true;
-            root->_left()->display(std::cout);
-        }
+            instrument.comparison();
 
-        if (root->_right())
-        {
-            if (left) std::cout << ", ";
-            root->_right()->display(std::cout);
+            if (current->_data() < key) current = current->_right();
+
+            else
+            {
+                found = current;
+                current = current->_left();
+            }
         }
 
-        std::cout << '\n';
+        return const_iterator(found, this);
+    }
+
+    //The first item that is greater than |key|, end() if there is none
+    template <typename K>
+    const_iterator upper_bound(const K& key) const
+    {
+        NodeT* found = nullptr;
+
+        for (NodeT* current = root; current;)
+        {
+            instrument.comparison();
+
+            if (key < current->_data())
+            {
+                found = current;
+                current = current->_left();
+            }
+
+            else current = current->_right();
+        }
+
+        return const_iterator(found, this);
+    }
+
+    //The first item equal to |key|, end() if there is none
+    template <typename K>
+    const_iterator find(const K& key) const
+    {
+        const_iterator found = lower_bound(key);
+
+        if (found != end() && key < *found) return end();
+        return found;
+    }
+
+    //True if an item equal to |key| is in the tree
+    template <typename K>
+    bool contains(const K& key) const
+    {
+        return find(key) != end();
+    }
+
+    //////////////// ORDER STATISTICS
+    //Only available with |OrderStatistics| set
+
+    //The number of items less than |key|
+    template <typename K>
+    size_t rank(const K& key) const
+    {
+        static_assert(OrderStatistics, "rank needs an AvlTree with OrderStatistics");
+
+        size_t less = 0;
+
+        for (NodeT* current = root; current;)
+        {
+            instrument.comparison();
+
+            if (current->_data() < key)
+            {
+                less += size(current->_left()) + 1;
+                current = current->_right();
+            }
+
+            else current = current->_left();
+        }
+
+        return less;
+    }
+
+    //The item at position |index| in order, starting from 0, end() if there are not that many
+    const_iterator select(size_t index) const
+    {
+        static_assert(OrderStatistics, "select needs an AvlTree with OrderStatistics");
+
+        NodeT* current = root;
+
+        while (current)
+        {
+            size_t leftSize = size(current->_left());
+
+            if (index < leftSize) current = current->_left();
+            else if (index == leftSize) break;
+
+            else
+            {
+                index -= leftSize + 1;
+                current = current->_right();
+            }
+        }
+
+        return const_iterator(current, this);
+    }
+
+    //The number of items in [|lo|, |hi|)
+    template <typename K>
+    size_t count(const K& lo, const K& hi) const
+    {
+        size_t below = rank(lo);
+        size_t upTo = rank(hi);
+
+        return upTo > below ? upTo - below : 0;
+    }
+
+    //////////////// ITERATION
+
+    const_iterator begin() const
+    {
+        return const_iterator(leftmost(root), this);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(nullptr, this);
+    }
+
+    const_reverse_iterator rbegin() const
+    {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    //Displays every item in order, walking the parent links
+    void display(std::ostream& out = std::cout) const
+    {
+        for (NodeT* current = leftmost(root); current; current = successor(current))
+            current->display(out);
+    }
+
+    //Displays the children of every inner node level by level, in pre-order
+    void debugDisplay() const
+    {
+        if (!root) return;
+
+        std::cout << "\nROOT   : ";
+        root->display(std::cout);
+        std::cout << '\n';
+
+        //Nodes still to visit with their level, a pre-order walk holds at most one pending
+        //sibling per level
+        std::pair<NodeT*, size_t> pending[MAX_HEIGHT + 1];
+        size_t count = 0;
+
+        pending[count++] = { root, 1 };
+
+        while (count)
+        {
+            NodeT* current = pending[count - 1].first;
+            size_t level = pending[--count].second;
+
+            if (current->isLeaf()) continue;
+
+            std::cout << "LVL " << level;
+
+            if (level < 10) std::cout << "  : ";
+            else std::cout << " : ";
+
+            //True if a left item was displayed
+            bool left = false;
+
+            if (current->_left())
+            {
+                left = true;
+                current->_left()->display(std::cout);
+            }
+
+            if (current->_right())
+            {
+                if (left) std::cout << ", ";
+                current->_right()->display(std::cout);
+            }
+
+            std::cout << '\n';
+
+            //The left subtree is displayed first
+            if (current->_right()) pending[count++] = { current->_right(), level + 1 };
+            if (current->_left()) pending[count++] = { current->_left(), level + 1 };
+        }
+    }
+
+    private:
+
+    //////////////// CONSTANTS
+
+    static constexpr size_t MAX_HEIGHT = avl_detail::MAX_HEIGHT;
+
+    //Below this many items from_unsorted sorts on the calling thread
+    static constexpr size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+    //Set operations only fork on subtrees at least this high, about a thousand items or more
+    static constexpr size_t PARALLEL_HEIGHT_THRESHOLD = 15;
+
+    //////////////// DATA 
+
+    //The root node of the tree
+    NodeT* root;
+
+    //The number of items in the tree
+    size_t dataCount;
+
+    //Receives the tree's work, mutable so lookups can report their comparisons
+    mutable Instrument instrument;
+
+    //////////////// PRIVATE FUNCTIONS 
+
+    //Builds a balanced subtree from the next |count| sorted items, advancing |next| past them
+    //The middle item becomes the root, so the two halves differ by at most one item and one level
+    template <typename It>
+    NodeT* build(It& next, size_t count)
+    {
+        if (!count) return nullptr;
+
+        NodeT* left = build(next, count / 2);
+
+        NodeT* node = new NodeT(*next);
+        ++next;
+
+        instrument.allocation();
+
+        NodeT* right = build(next, count - count / 2 - 1);
+
+        node->setLeft(left);
+        node->setRight(right);
+        node->updateHeight();
+        node->updateSize();
+
+        return node;
+    }
+
+    //////////////// JOIN PRIMITIVES
+    //Subtrees passed to and returned from these have no parent
+
+    static size_t height(NodeT* root)
+    {
+        return root ? root->getHeight() : 0;
+    }
+
+    //Makes |node| the parent of |left| and |right| and returns it
+    static NodeT* link(NodeT* left, NodeT* node, NodeT* right)
+    {
+        node->setLeft(left);
+        node->setRight(right);
+        node->_parent() = nullptr;
+
+        node->updateHeight();
+        node->updateSize();
+
+        return node;
+    }
+
+    //Detaches the children of |node|
+    static void expose(NodeT* node, NodeT*& left, NodeT*& right)
+    {
+        left = node->_left();
+        right = node->_right();
+
+        if (left) left->_parent() = nullptr;
+        if (right) right->_parent() = nullptr;
+
+        node->_left() = nullptr;
+        node->_right() = nullptr;
+    }
+
+    //Links |left|, |node| and |right|, where |left| is higher than |right| by more than one level
+    //Descends the right spine of |left| to a subtree |right| can sit beside, rebalancing on the way back
+    static NodeT* joinRight(NodeT* left, NodeT* node, NodeT* right)
+    {
+        NodeT *leftLeft, *leftRight;
+        expose(left, leftLeft, leftRight);
+
+        if (height(leftRight) <= height(right) + 1)
+        {
+            NodeT* joined = link(leftRight, node, right);
+
+            if (height(joined) <= height(leftLeft) + 1) return link(leftLeft, left, joined);
+
+            //The new subtree is two levels higher than its sibling, a double rotation
+            rotateRight(joined);
+
+            NodeT* top = link(leftLeft, left, joined);
+            rotateLeft(top);
+
+            return top;
+        }
+
+        NodeT* joined = joinRight(leftRight, node, right);
+        NodeT* top = link(leftLeft, left, joined);
+
+        if (height(joined) > height(leftLeft) + 1) rotateLeft(top);
+
+        return top;
+    }
+
+    //The mirror of joinRight, |right| is higher than |left| by more than one level
+    static NodeT* joinLeft(NodeT* left, NodeT* node, NodeT* right)
+    {
+        NodeT *rightLeft, *rightRight;
+        expose(right, rightLeft, rightRight);
+
+        if (height(rightLeft) <= height(left) + 1)
+        {
+            NodeT* joined = link(left, node, rightLeft);
+
+            if (height(joined) <= height(rightRight) + 1) return link(joined, right, rightRight);
+
+            //The new subtree is two levels higher than its sibling, a double rotation
+            rotateLeft(joined);
+
+            NodeT* top = link(joined, right, rightRight);
+            rotateRight(top);
+
+            return top;
+        }
+
+        NodeT* joined = joinLeft(left, node, rightLeft);
+        NodeT* top = link(joined, right, rightRight);
+
+        if (height(joined) > height(rightRight) + 1) rotateRight(top);
+
+        return top;
+    }
+
+    //Links |left|, |node| and |right| into a balanced tree, every item of |left| coming first
+    static NodeT* join(NodeT* left, NodeT* node, NodeT* right)
+    {
+        if (height(left) > height(right) + 1) return joinRight(left, node, right);
+        if (height(right) > height(left) + 1) return joinLeft(left, node, right);
+
+        return link(left, node, right);
+    }
+
+    //Detaches the node of the largest item of |root|, |rest| is set to the other items
+    static NodeT* splitLast(NodeT* root, NodeT*& rest)
+    {
+        NodeT *left, *right;
+        expose(root, left, right);
+
+        if (!right)
+        {
+            rest = left;
+            return root;
+        }
+
+        NodeT* last = splitLast(right, right);
+        rest = join(left, root, right);
+
+        return last;
+    }
+
+    //Joins two trees without a middle node
+    static NodeT* join2(NodeT* left, NodeT* right)
+    {
+        if (!left) return right;
+        if (!right) return left;
+
+        NodeT* rest;
+        NodeT* last = splitLast(left, rest);
+
+        return join(rest, last, right);
+    }
+
+    //Splits |root| into the items less than |key| and the rest
+    template <typename K>
+    static void splitLess(NodeT* root, const K& key, NodeT*& less, NodeT*& rest)
+    {
+        if (!root)
+        {
+            less = rest = nullptr;
+            return;
+        }
+
+        NodeT *left, *right;
+        expose(root, left, right);
+
+        if (root->_data() < key)
+        {
+            splitLess(right, key, right, rest);
+            less = join(left, root, right);
+        }
+
+        else
+        {
+            splitLess(left, key, less, left);
+            rest = join(left, root, right);
+        }
+    }
+
+    //Splits |root| into the items less than and greater than |key|
+    //Returns the detached node equal to |key|, null if there is none
+    static NodeT* splitAround(NodeT* root, const T& key, NodeT*& less, NodeT*& greater)
+    {
+        if (!root)
+        {
+            less = greater = nullptr;
+            return nullptr;
+        }
+
+        NodeT *left, *right;
+        expose(root, left, right);
+
+        NodeT* equal = root;
+
+        if (root->_data() < key)
+        {
+            equal = splitAround(right, key, right, greater);
+            less = join(left, root, right);
+        }
+
+        else if (key < root->_data())
+        {
+            equal = splitAround(left, key, less, left);
+            greater = join(left, root, right);
+        }
+
+        else
+        {
+            less = left;
+            greater = right;
+        }
+
+        return equal;
+    }
+
+    //Deletes every node of |root|, returning how many there were
+    static size_t discard(NodeT* root)
+    {
+        size_t counted = 0;
+
+        for (NodeT* current = leftmost(root); current; current = successor(current)) ++counted;
+
+        NodeT::destroy(root);
+
+        return counted;
+    }
+
+    //////////////// SET OPERATIONS
+
+    //A set operation on two subtrees, |forks| more levels may run in parallel and
+    //|dropped| counts the nodes deleted
+    using SetOperation = NodeT* (*)(NodeT*, NodeT*, size_t, std::atomic<size_t>&);
+
+    static AvlTree combine(AvlTree&& a, AvlTree&& b, size_t threads, SetOperation operation)
+    {
+        //Every fork doubles the running tasks
+        size_t forks = 0;
+        while ((size_t(1) << forks) < threads) ++forks;
+
+        std::atomic<size_t> dropped{ 0 };
+
+        AvlTree result(std::move(a));
+
+        result.root = operation(result.root, b.root, forks, dropped);
+        result.dataCount += b.dataCount - dropped;
+
+        b.root = nullptr;
+        b.dataCount = 0;
+
+        return result;
+    }
+
+    //Runs |operation| on both pairs of halves, in parallel when both sides are worth it
+    static void both(SetOperation operation, NodeT* a1, NodeT* b1, NodeT*& result1,
+                     NodeT* a2, NodeT* b2, NodeT*& result2, size_t forks, std::atomic<size_t>& dropped)
+    {
+        if (forks && std::min(height(a1), height(a2)) + 1 >= PARALLEL_HEIGHT_THRESHOLD)
+        {
+            auto task = std::async(std::launch::async, [=, &dropped]() { return operation(a1, b1, forks - 1, dropped); });
+
+            result2 = operation(a2, b2, forks - 1, dropped);
+            result1 = task.get();
+            return;
+        }
+
+        result1 = operation(a1, b1, forks, dropped);
+        result2 = operation(a2, b2, forks, dropped);
+    }
+
+    static NodeT* unite(NodeT* a, NodeT* b, size_t forks, std::atomic<size_t>& dropped)
+    {
+        if (!a) return b;
+        if (!b) return a;
+
+        NodeT *aLeft, *aRight, *bLeft, *bRight;
+        expose(a, aLeft, aRight);
+
+        if (NodeT* equal = splitAround(b, a->_data(), bLeft, bRight))
+        {
+            delete equal;
+            ++dropped;
+        }
+
+        NodeT *left, *right;
+        both(unite, aLeft, bLeft, left, aRight, bRight, right, forks, dropped);
+
+        return join(left, a, right);
+    }
+
+    static NodeT* intersect(NodeT* a, NodeT* b, size_t forks, std::atomic<size_t>& dropped)
+    {
+        if (!a || !b)
+        {
+            dropped += discard(a) + discard(b);
+            return nullptr;
+        }
+
+        NodeT *aLeft, *aRight, *bLeft, *bRight;
+        expose(a, aLeft, aRight);
+
+        NodeT* equal = splitAround(b, a->_data(), bLeft, bRight);
+
+        NodeT *left, *right;
+        both(intersect, aLeft, bLeft, left, aRight, bRight, right, forks, dropped);
+
+        if (equal)
+        {
+            delete equal;
+            ++dropped;
+
+            return join(left, a, right);
+        }
+
+        delete a;
+        ++dropped;
+
+        return join2(left, right);
+    }
+
+    static NodeT* subtract(NodeT* a, NodeT* b, size_t forks, std::atomic<size_t>& dropped)
+    {
+        if (!a)
+        {
+            dropped += discard(b);
+            return nullptr;
+        }
+
+        if (!b) return a;
+
+        NodeT *aLeft, *aRight, *bLeft, *bRight;
+        expose(a, aLeft, aRight);
+
+        NodeT* equal = splitAround(b, a->_data(), bLeft, bRight);
+
+        NodeT *left, *right;
+        both(subtract, aLeft, bLeft, left, aRight, bRight, right, forks, dropped);
+
+        if (!equal) return join(left, a, right);
+
+        delete equal;
+        delete a;
+        dropped += 2;
+
+        return join2(left, right);
+    }
+
+    //Sorts |items|, in |threads| runs sorted concurrently and merged pairwise when there are enough
+    static void sort(std::vector<T>& items, size_t threads)
+    {
+        if (threads < 2 || items.size() < PARALLEL_SORT_THRESHOLD)
+        {
+            std::sort(items.begin(), items.end());
+            return;
+        }
+
+        //Run |i| is [bounds[i], bounds[i + 1])
+        std::vector<size_t> bounds(threads + 1);
+        for (size_t i = 0; i <= threads; ++i) bounds[i] = items.size() * i / threads;
+
+        std::vector<std::future<void>> tasks;
+
+        for (size_t i = 0; i < threads; ++i)
+        {
+            auto first = items.begin() + bounds[i];
+            auto last = items.begin() + bounds[i + 1];
+
+            tasks.push_back(std::async(std::launch::async, [first, last]() { std::sort(first, last); }));
+        }
+
+        for (auto& task : tasks) task.get();
+
+        //Each round merges neighbouring runs, doubling their width
+        for (size_t width = 1; width < threads; width *= 2)
+        {
+            tasks.clear();
+
+            for (size_t i = 0; i + width < threads; i += 2 * width)
+            {
+                auto first = items.begin() + bounds[i];
+                auto middle = items.begin() + bounds[i + width];
+                auto last = items.begin() + bounds[std::min(i + 2 * width, threads)];
+
+                tasks.push_back(std::async(std::launch::async, [first, middle, last]() { std::inplace_merge(first, middle, last); }));
+            }
+
+            for (auto& task : tasks) task.get();
+        }
+    }
+
+    //Takes |node| out of the tree and rebalances, |next| is set to the node holding the following item
+    //Returns the detached node holding the removed item, it has no children left
+    //No other node is freed or has its item moved, so only iterators to |node| are invalidated
+    NodeT* unlink(NodeT* node, NodeT*& next)
+    {
+        next = successor(node);
+
+        NodeT* parent = node->_parent();
+        NodeT*& slot = slotOf(node);
+
+        //the lowest node whose subtree lost an item, retracing starts there
+        NodeT* changed = parent;
+
+        //A node with two children is replaced by its successor node, which has no left child
+        //The successor is spliced out of its own position first, then takes over the links,
+        //height and size of |node|
+        if (node->_left() && node->_right())
+        {
+            if (next->_parent() == node) changed = next;
+
+            else
+            {
+                changed = next->_parent();
+                changed->setLeft(next->_right());
+                next->setRight(node->_right());
+            }
+
+            next->setLeft(node->_left());
+            next->takeShape(*node);
+            next->_parent() = parent;
+            slot = next;
+        }
+
+        //Otherwise the node's only child (if any) takes its place
+        else
+        {
+            NodeT* child = node->_left() ? node->_left() : node->_right();
+
+            slot = child;
+            if (child) child->_parent() = parent;
+        }
+
+        node->_left() = nullptr;
+        node->_right() = nullptr;
+        node->_parent() = nullptr;
+
+        --dataCount;
+
+        //Every ancestor loses an item, whether or not retracing reaches it
+        if constexpr (OrderStatistics)
+            for (NodeT* ancestor = changed; ancestor; ancestor = ancestor->_parent()) ancestor->resize(-1);
+
+        retrace(changed);
+
+        return node;
+    }
+
+    //Walks up from |node| fixing heights and balance after a removal below it
+    //Stops as soon as a subtree is back to its previous height, nothing above it changed
+    void retrace(NodeT* node)
+    {
+        while (node)
+        {
+            NodeT* parent = node->_parent();
+            NodeT*& slot = slotOf(node);
+
+            size_t previousHeight = node->getHeight();
+            bool hasLeftImbalance = false;
+
+            node->updateHeight();
+
+            if (node->isUnbalanced(hasLeftImbalance))
+            {
+                instrument.imbalance(*node);
+                rebalance(slot, hasLeftImbalance);
+            }
+
+            if (slot->getHeight() == previousHeight) return;
+
+            node = parent;
+        }
+    }
+
+    //The pointer that holds |node|, either a child link of its parent or |root|
+    NodeT*& slotOf(NodeT* node)
+    {
+        NodeT* parent = node->_parent();
+
+        if (!parent) return root;
+        return parent->_left() == node ? parent->_left() : parent->_right();
+    }
+
+    //////////////// BALANCING ROTATIONS 
+
+    //Restores balance at |root|, whose subtrees differ in height by 2
+    //The child on the taller side decides between a single and a double rotation
+    void rebalance(NodeT*& root, bool hasLeftImbalance)
+    {
+        if (hasLeftImbalance)
+        {
+            //1) The root's left child has a left subtree imbalance : LeftLeft
+            //2) The root's left child has a right subtree imbalance : LeftRight
+            bool isDouble = root->_left()->isRightHeavy();
+            instrument.rotation(isDouble ? Rotation::LeftRight : Rotation::LeftLeft);
+
+            if (isDouble) rotateLeft(root->_left());
+            rotateRight(root);
+        }
+
+        else
+        {
+            //3) The root's right child has a left subtree imbalance : RightLeft
+            //4) The root's right child has a right subtree imbalance : RightRight
+            bool isDouble = root->_right()->isLeftHeavy();
+            instrument.rotation(isDouble ? Rotation::RightLeft : Rotation::RightRight);
+
+            if (isDouble) rotateRight(root->_right());
+            rotateLeft(root);
+        }
+    }
+
+    static void rotateRight(NodeT*& root)
+    {
+        //Hold onto the old root and its parent
+        NodeT* oldRoot = root;
+        NodeT* parent = oldRoot->_parent();
+
+        //Set the left child to be the new root
+        root = root->_left();
 
-        debugDisplay(root->_left(), level + 1);
-        debugDisplay(root->_right(), level + 1);
+        //Set the old root's left to the new root's right subtree (null possiblity)
+        oldRoot->setLeft(root->_right());
+        
+        //Adopt |oldRoot| as right subtree
+        root->setRight(oldRoot);
+        root->_parent() = parent;
+
+        //Update the node heights and subtree sizes
+        oldRoot->updateHeight();
+        oldRoot->updateSize();
+        root->updateHeight();
+        root->updateSize();
+    }
+
+    static void rotateLeft(NodeT*& root)
+    {
+        //Hold onto the old root and its parent
+        NodeT* oldRoot = root;
+        NodeT* parent = oldRoot->_parent();
+
+        //Set the right child to be the new root
+        root = root->_right();
+
+        //Set the old root's right to the new root's left subtree (null possiblity)
+        oldRoot->setRight(root->_left());
+        
+        //Adopt |oldRoot| as left subtree
+        root->setLeft(oldRoot);
+        root->_parent() = parent;
+
+        //Update the node heights and subtree sizes
+        oldRoot->updateHeight();
+        oldRoot->updateSize();
+        root->updateHeight();
+        root->updateSize();
+    }
+
+    //The number of items in the subtree at |root|, 0 if it is empty
+    static size_t size(NodeT* root)
+    {
+        return root ? root->getSize() : 0;
+    }
+
+    //////////////// IN-ORDER NAVIGATION
+
+    //The smallest item of the subtree at |root|, null if it is empty
+    static NodeT* leftmost(NodeT* root)
+    {
+        if (root) while (root->_left()) root = root->_left();
+        return root;
+    }
+
+    //The largest item of the subtree at |root|, null if it is empty
+    static NodeT* rightmost(NodeT* root)
+    {
+        if (root) while (root->_right()) root = root->_right();
+        return root;
+    }
+
+    //The next item in order, null after the largest
+    static NodeT* successor(NodeT* node)
+    {
+        if (node->_right()) return leftmost(node->_right());
+
+        //Climb until coming up from a left subtree
+        NodeT* parent = node->_parent();
+
+        while (parent && node == parent->_right())
+        {
+            node = parent;
+            parent = parent->_parent();
+        }
+
+        return parent;
+    }
+
+    //The previous item in order, null before the smallest
+    static NodeT* predecessor(NodeT* node)
+    {
+        if (node->_left()) return rightmost(node->_left());
+
+        //Climb until coming up from a right subtree
+        NodeT* parent = node->_parent();
+
+        while (parent && node == parent->_left())
+        {
+            node = parent;
+            parent = parent->_parent();
+        }
+
+        return parent;
     }
 };
 
+//An AvlTree keeping subtree sizes, for rank, select and count
+template <typename T, typename Instrument = NoInstrumentation>
+using OrderStatisticTree = AvlTree<T, Instrument, true>;
+
 #endif // AVL_HPP
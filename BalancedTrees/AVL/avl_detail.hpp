@@ -0,0 +1,48 @@
+#ifndef AVL_DETAIL_HPP
+#define AVL_DETAIL_HPP
+
+#include <cstddef>
+
+/*
+Pieces shared by AvlTree and CompactAvlTree, which differ in how their nodes are linked but not in
+how tall a tree can grow or how a subtree is taken apart.
+*/
+
+namespace avl_detail
+{
+
+//An AVL tree of N items is less than 1.45 log2(N + 2) high, 92 for any N a size_t can count
+//Fixed-size path stacks of this many entries hold any root-to-leaf path
+constexpr size_t MAX_HEIGHT = 96;
+
+//Deletes every node of the subtree at |root|, without recursion and without extra memory
+//The subtree is unwound by rotating left children up, a node is freed once it has no left child
+//|links| reads and writes the child links with left, right, setLeft and setRight and frees a
+//node with release, a null handle converts to false
+template <typename Links, typename Handle>
+void unwind(Links& links, Handle root)
+{
+    while (root)
+    {
+        Handle leftChild = links.left(root);
+
+        if (leftChild)
+        {
+            links.setLeft(root, links.right(leftChild));
+            links.setRight(leftChild, root);
+            root = leftChild;
+        }
+
+        else
+        {
+            Handle rightChild = links.right(root);
+
+            links.release(root);
+            root = rightChild;
+        }
+    }
+}
+
+}
+
+#endif //AVL_DETAIL_HPP
@@ -0,0 +1,605 @@
+#ifndef COMPACT_AVL_HPP
+#define COMPACT_AVL_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "avl.hpp"
+#include "avl_detail.hpp"
+
+/*
+A memory-lean AVL tree for large sets of small items.
+
+Where AvlTree's Node holds a pointer to a separately allocated item, two child pointers, a parent
+pointer and a full height, a compact node holds the item inline, its two child links and a balance
+factor (-1, 0 or +1) packed into two spare bits of the left link. Without parent links the tree
+walks down with a fixed-size path stack and retraces from it, as AvlTree::insert does.
+
+The links are chosen with the |Links| policy :
+
+    PointerLinks : nodes are allocated one by one and linked by pointers, the balance factor uses
+                   the two low bits of the left pointer, which alignment leaves at 0
+    PooledLinks  : nodes live in one growing pool and are linked by 32-bit indices, the balance
+                   factor uses the two high bits of the left index, leaving room for 2^30 - 1 nodes
+
+For an int item that is 24 bytes per node plus the allocator's header with PointerLinks, and 12
+bytes with PooledLinks, against more than 60 for AvlTree. Pointers handed out by find and
+lower_bound are invalidated by the next insert with PooledLinks, the pool may move when it grows.
+*/
+
+////////////////////////////// POINTER LINKS
+
+template <typename T>
+class PointerLinks
+{
+    public:
+
+    struct Node
+    {
+        T data;
+
+        //The left child, with the balance factor + 1 in the two low bits
+        uintptr_t left;
+
+        Node* right;
+
+        Node(const T& data) : data(data), left(1), right(nullptr) {}
+    };
+
+    static_assert(alignof(Node) >= 4, "the two low bits of a node address must be free");
+
+    using Handle = Node*;
+    static constexpr Handle null = nullptr;
+
+    //////////////// PUBLIC FUNCTIONS
+
+    Handle allocate(const T& data)
+    {
+        return new Node(data);
+    }
+
+    void release(Handle node)
+    {
+        delete node;
+    }
+
+    //Nodes are allocated on demand
+    void reserve(size_t) {}
+
+    T& data(Handle node)
+    {
+        return node->data;
+    }
+
+    const T& data(Handle node) const
+    {
+        return node->data;
+    }
+
+    Handle left(Handle node) const
+    {
+        return reinterpret_cast<Node*>(node->left & ~uintptr_t(3));
+    }
+
+    Handle right(Handle node) const
+    {
+        return node->right;
+    }
+
+    void setLeft(Handle node, Handle child)
+    {
+        node->left = reinterpret_cast<uintptr_t>(child) | (node->left & 3);
+    }
+
+    void setRight(Handle node, Handle child)
+    {
+        node->right = child;
+    }
+
+    //The height of the right subtree minus the height of the left subtree
+    int balance(Handle node) const
+    {
+        return int(node->left & 3) - 1;
+    }
+
+    void setBalance(Handle node, int balance)
+    {
+        node->left = (node->left & ~uintptr_t(3)) | uintptr_t(balance + 1);
+    }
+
+    //Deletes every node of the subtree at |root| by rotating left children up, without recursion
+    void clear(Handle root)
+    {
+        avl_detail::unwind(*this, root);
+    }
+};
+
+////////////////////////////// POOLED LINKS
+
+template <typename T, typename Index = uint32_t>
+class PooledLinks
+{
+    public:
+
+    struct Node
+    {
+        T data;
+
+        //The left child, with the balance factor + 1 in the two high bits
+        Index left;
+
+        Index right;
+    };
+
+    //A handle is a pool position + 1, so that 0 can stand for no node
+    using Handle = Index;
+    static constexpr Handle null = 0;
+
+    //////////////// PUBLIC FUNCTIONS
+
+    //Throws std::length_error once every index that fits beside the balance bits is used
+    Handle allocate(const T& data)
+    {
+        if (freeList)
+        {
+            Handle node = freeList;
+            freeList = pool[node - 1].right;
+
+            pool[node - 1] = Node{ data, BALANCED, null };
+            return node;
+        }
+
+        if (pool.size() >= LINK_MASK) throw std::length_error("PooledLinks : node pool is full");
+
+        pool.push_back(Node{ data, BALANCED, null });
+        return Handle(pool.size());
+    }
+
+    //The slot is kept for the next allocation, its item is only overwritten then
+    void release(Handle node)
+    {
+        pool[node - 1].right = freeList;
+        freeList = node;
+    }
+
+    void reserve(size_t count)
+    {
+        pool.reserve(count);
+    }
+
+    T& data(Handle node)
+    {
+        return pool[node - 1].data;
+    }
+
+    const T& data(Handle node) const
+    {
+        return pool[node - 1].data;
+    }
+
+    Handle left(Handle node) const
+    {
+        return pool[node - 1].left & LINK_MASK;
+    }
+
+    Handle right(Handle node) const
+    {
+        return pool[node - 1].right;
+    }
+
+    void setLeft(Handle node, Handle child)
+    {
+        Index& link = pool[node - 1].left;
+        link = (link & ~LINK_MASK) | child;
+    }
+
+    void setRight(Handle node, Handle child)
+    {
+        pool[node - 1].right = child;
+    }
+
+    //The height of the right subtree minus the height of the left subtree
+    int balance(Handle node) const
+    {
+        return int(pool[node - 1].left >> LINK_BITS) - 1;
+    }
+
+    void setBalance(Handle node, int balance)
+    {
+        Index& link = pool[node - 1].left;
+        link = (link & LINK_MASK) | (Index(balance + 1) << LINK_BITS);
+    }
+
+    //Every node is in the pool, it is emptied at once
+    void clear(Handle)
+    {
+        pool.clear();
+        freeList = null;
+    }
+
+    private:
+
+    //////////////// CONSTANTS
+
+    static constexpr unsigned LINK_BITS = sizeof(Index) * 8 - 2;
+    static constexpr Index LINK_MASK = (Index(1) << LINK_BITS) - 1;
+
+    //A null left link with a balance factor of 0
+    static constexpr Index BALANCED = Index(1) << LINK_BITS;
+
+    //////////////// DATA
+
+    std::vector<Node> pool;
+
+    //Released slots, chained through their right links
+    Handle freeList = null;
+};
+
+////////////////////////////// COMPACT AVL TREE
+
+template <typename T, typename Links = PointerLinks<T>, typename Instrument = NoInstrumentation>
+class CompactAvlTree
+{
+    using Handle = typename Links::Handle;
+
+    public:
+
+    //////////////// CONSTRUCTORS
+
+    CompactAvlTree() : root(Links::null), dataCount(0) {}
+
+    explicit CompactAvlTree(const Instrument& instrument) : root(Links::null), dataCount(0), instrument(instrument) {}
+
+    CompactAvlTree(const CompactAvlTree&) = delete;
+    CompactAvlTree& operator=(const CompactAvlTree&) = delete;
+
+    ~CompactAvlTree()
+    {
+        clear();
+    }
+
+    //////////////// PUBLIC FUNCTIONS
+
+    //Equal items are kept, after the ones already in the tree
+    void insert(const T& data)
+    {
+        Handle path[MAX_HEIGHT];
+        bool wentRight[MAX_HEIGHT];
+        size_t depth = 0;
+
+        for (Handle current = root; current != Links::null; ++depth)
+        {
+            instrument.comparison();
+
+            path[depth] = current;
+            wentRight[depth] = !(data < links.data(current));
+            current = child(current, wentRight[depth]);
+        }
+
+        Handle node = links.allocate(data);
+        ++dataCount;
+
+        instrument.allocation();
+        instrument.depth(depth + 1);
+
+        relink(path, wentRight, depth, node);
+
+        //Retrace until a subtree keeps its height, at most one rebalance is needed
+        while (depth--)
+        {
+            Handle current = path[depth];
+            int balance = links.balance(current) + (wentRight[depth] ? 1 : -1);
+
+            if (balance == 0)
+            {
+                links.setBalance(current, 0);
+                return;
+            }
+
+            if (balance == 1 || balance == -1)
+            {
+                links.setBalance(current, balance);
+                continue;
+            }
+
+            bool isShorter = false;
+            relink(path, wentRight, depth, rebalance(current, balance, isShorter));
+            return;
+        }
+    }
+
+    //Removes every item equal to |key|
+    //Returns the number of items removed
+    template <typename K>
+    size_t erase(const K& key)
+    {
+        size_t removed = 0;
+
+        while (eraseOne(key)) ++removed;
+
+        return removed;
+    }
+
+    //The first item equal to |key|, null if there is none
+    template <typename K>
+    const T* find(const K& key) const
+    {
+        const T* found = lower_bound(key);
+
+        if (found && key < *found) return nullptr;
+        return found;
+    }
+
+    //The first item that is not less than |key|, null if there is none
+    template <typename K>
+    const T* lower_bound(const K& key) const
+    {
+        const T* found = nullptr;
+
+        for (Handle current = root; current != Links::null;)
+        {
+            instrument.comparison();
+
+            if (links.data(current) < key) current = links.right(current);
+
+            else
+            {
+                found = &links.data(current);
+                current = links.left(current);
+            }
+        }
+
+        return found;
+    }
+
+    template <typename K>
+    bool contains(const K& key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    //Calls |visit| with every item in order
+    template <typename F>
+    void forEach(F visit) const
+    {
+        Handle pending[MAX_HEIGHT];
+        size_t count = 0;
+
+        for (Handle current = root; current != Links::null || count;)
+        {
+            if (current != Links::null)
+            {
+                pending[count++] = current;
+                current = links.left(current);
+            }
+
+            else
+            {
+                current = pending[--count];
+                visit(links.data(current));
+                current = links.right(current);
+            }
+        }
+    }
+
+    //The number of items in the tree
+    size_t size() const
+    {
+        return dataCount;
+    }
+
+    bool empty() const
+    {
+        return !dataCount;
+    }
+
+    //Makes room for |count| nodes up front, when the links come from a pool
+    void reserve(size_t count)
+    {
+        links.reserve(count);
+    }
+
+    //Removes every item, without recursion
+    void clear()
+    {
+        links.clear(root);
+
+        root = Links::null;
+        dataCount = 0;
+    }
+
+    const Instrument& instrumentation() const
+    {
+        return instrument;
+    }
+
+    Instrument& instrumentation()
+    {
+        return instrument;
+    }
+
+    private:
+
+    //////////////// CONSTANTS
+
+    static constexpr size_t MAX_HEIGHT = avl_detail::MAX_HEIGHT;
+
+    //////////////// DATA
+
+    Links links;
+    Handle root;
+
+    //The number of items in the tree
+    size_t dataCount;
+
+    //Receives the tree's work, mutable so lookups can report their comparisons
+    mutable Instrument instrument;
+
+    //////////////// PRIVATE FUNCTIONS
+
+    Handle child(Handle node, bool isRight) const
+    {
+        return isRight ? links.right(node) : links.left(node);
+    }
+
+    //Links |node| where the walk recorded in |path| left off at |depth|
+    void relink(const Handle* path, const bool* wentRight, size_t depth, Handle node)
+    {
+        if (!depth) root = node;
+        else if (wentRight[depth - 1]) links.setRight(path[depth - 1], node);
+        else links.setLeft(path[depth - 1], node);
+    }
+
+    //Removes one item equal to |key|, false if there is none
+    template <typename K>
+    bool eraseOne(const K& key)
+    {
+        Handle path[MAX_HEIGHT];
+        bool wentRight[MAX_HEIGHT];
+        size_t depth = 0;
+
+        Handle node = root;
+
+        while (node != Links::null)
+        {
+            instrument.comparison();
+
+            if (key < links.data(node)) wentRight[depth] = false;
+            else if (links.data(node) < key) wentRight[depth] = true;
+            else break;
+
+            path[depth++] = node;
+            node = child(node, wentRight[depth - 1]);
+        }
+
+        if (node == Links::null) return false;
+
+        //A node with two children takes the item of its successor, which has no left child
+        if (links.left(node) != Links::null && links.right(node) != Links::null)
+        {
+            Handle successor = links.right(node);
+
+            path[depth] = node;
+            wentRight[depth++] = true;
+
+            while (links.left(successor) != Links::null)
+            {
+                path[depth] = successor;
+                wentRight[depth++] = false;
+                successor = links.left(successor);
+            }
+
+            std::swap(links.data(node), links.data(successor));
+            node = successor;
+        }
+
+        Handle only = links.left(node) != Links::null ? links.left(node) : links.right(node);
+
+        relink(path, wentRight, depth, only);
+        links.release(node);
+        --dataCount;
+
+        //Retrace until a subtree keeps its height
+        while (depth--)
+        {
+            Handle current = path[depth];
+            int balance = links.balance(current) + (wentRight[depth] ? -1 : 1);
+
+            if (balance == 1 || balance == -1)
+            {
+                links.setBalance(current, balance);
+                return true;
+            }
+
+            if (balance == 0)
+            {
+                links.setBalance(current, 0);
+                continue;
+            }
+
+            bool isShorter = false;
+            relink(path, wentRight, depth, rebalance(current, balance, isShorter));
+
+            if (!isShorter) return true;
+        }
+
+        return true;
+    }
+
+    //////////////// BALANCING ROTATIONS
+
+    //Rotates |node|, whose balance factor would be |balance| (+2 or -2), and sets the new factors
+    //Returns the subtree's new root, |isShorter| is set if the subtree is now one level lower
+    //than it was with the factor of |balance|
+    Handle rebalance(Handle node, int balance, bool& isShorter)
+    {
+        bool isRightHeavy = balance > 0;
+
+        Handle taller = child(node, isRightHeavy);
+        int tallerBalance = links.balance(taller);
+
+        //A single rotation when the taller child leans the same way, or not at all
+        if (tallerBalance == 0 || (tallerBalance > 0) == isRightHeavy)
+        {
+            instrument.rotation(isRightHeavy ? Rotation::RightRight : Rotation::LeftLeft);
+
+            if (isRightHeavy)
+            {
+                links.setRight(node, links.left(taller));
+                links.setLeft(taller, node);
+            }
+
+            else
+            {
+                links.setLeft(node, links.right(taller));
+                links.setRight(taller, node);
+            }
+
+            //Only an erase can leave the taller child even, the height is then unchanged
+            int remaining = isRightHeavy ? 1 : -1;
+
+            links.setBalance(node, tallerBalance ? 0 : remaining);
+            links.setBalance(taller, tallerBalance ? 0 : -remaining);
+
+            isShorter = tallerBalance != 0;
+            return taller;
+        }
+
+        //A double rotation lifts the grandchild on the inner side
+        instrument.rotation(isRightHeavy ? Rotation::RightLeft : Rotation::LeftRight);
+
+        Handle inner = child(taller, !isRightHeavy);
+        int innerBalance = links.balance(inner);
+
+        if (isRightHeavy)
+        {
+            links.setLeft(taller, links.right(inner));
+            links.setRight(node, links.left(inner));
+            links.setLeft(inner, node);
+            links.setRight(inner, taller);
+
+            links.setBalance(node, innerBalance > 0 ? -1 : 0);
+            links.setBalance(taller, innerBalance < 0 ? 1 : 0);
+        }
+
+        else
+        {
+            links.setRight(taller, links.left(inner));
+            links.setLeft(node, links.right(inner));
+            links.setRight(inner, node);
+            links.setLeft(inner, taller);
+
+            links.setBalance(node, innerBalance < 0 ? 1 : 0);
+            links.setBalance(taller, innerBalance > 0 ? -1 : 0);
+        }
+
+        links.setBalance(inner, 0);
+
+        isShorter = true;
+        return inner;
+    }
+};
+
+#endif // COMPACT_AVL_HPP
@@ -1,38 +1,12 @@
+/* @author, Sean Siders, sean.siders@icloud.com */
+
 #include "avl.hpp"
+#include "compact_avl.hpp"
+#include "unit_tests.hpp"
 
 int main()
 {
-    AvlTree<int> tree;
-
-    tree.insert(50);
-
-    tree.debugDisplay();
-    std::cin.get();
-
-    tree.insert(45);
-    
-    tree.debugDisplay();
-    std::cin.get();
-
-    tree.insert(15);
-
-    tree.debugDisplay();
-    std::cin.get();
-
-    tree.insert(17);
-
-    tree.debugDisplay();
-    std::cin.get();
-
-    tree.insert(23);
-
-    tree.debugDisplay();
-    std::cin.get();
-
-    tree.insert(18);
-
-    tree.debugDisplay();
-    std::cin.get();
+    AvlTests<int> avl_tests;
 
     return 0;
 }
@@ -0,0 +1,558 @@
+/* @author, Sean Siders, sean.siders@icloud.com */
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "nuttiest/nuttiest.hpp"
+using namespace nuttiest;
+
+#ifndef UNIT_TESTS_HPP
+#define UNIT_TESTS_HPP
+
+//Every operation is checked against std::multiset holding the same items
+template <typename T>
+class AvlTests
+{
+    public:
+
+    AvlTests()
+    {
+        section("EMPTY TREE")
+        {
+            AvlTree<T> tree;
+
+            unit_test("is empty")
+            {
+                assert_eq(tree.empty(), true);
+                assert_eq(tree.size(), 0);
+            }
+
+            unit_test("begin is end")
+            {
+                assert_eq(tree.begin() == tree.end(), true);
+            }
+
+            unit_test("nothing to find")
+            {
+                assert_eq(tree.find(1) == tree.end(), true);
+                assert_eq(tree.erase(1), 0);
+                assert_eq(tree.extract(1).has_value(), false);
+            }
+        }
+
+        section("INSERT")
+        {
+            AvlTree<T> tree;
+            std::multiset<T> expected;
+
+            for (size_t i = 0; i < 5000; ++i)
+            {
+                T item = T(random() % 1000);
+
+                tree.insert(item);
+                expected.insert(item);
+            }
+
+            unit_test("matches std::multiset")
+            {
+                assert_eq(matches(tree, expected), true);
+            }
+
+            unit_test("lower_bound and upper_bound")
+            {
+                bool agree = true;
+
+                for (T key = -1; key <= 1001; ++key)
+                {
+                    agree &= same(tree, tree.lower_bound(key), expected, expected.lower_bound(key));
+                    agree &= same(tree, tree.upper_bound(key), expected, expected.upper_bound(key));
+                    agree &= tree.contains(key) == (expected.count(key) > 0);
+                }
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("sequential inserts stay sorted")
+            {
+                AvlTree<T> sequential;
+                std::multiset<T> sequentialExpected;
+
+                for (T item = 0; item < 10000; ++item)
+                {
+                    sequential.insert(item);
+                    sequentialExpected.insert(item);
+                }
+
+                assert_eq(matches(sequential, sequentialExpected), true);
+            }
+        }
+
+        section("ITERATORS")
+        {
+            AvlTree<T> tree;
+
+            for (T item = 0; item < 100; ++item) tree.insert(item);
+
+            unit_test("reverse iteration")
+            {
+                std::vector<T> backwards(tree.rbegin(), tree.rend());
+                assert_eq(backwards.size(), 100);
+                assert_eq(std::is_sorted(backwards.rbegin(), backwards.rend()), true);
+            }
+
+            unit_test("decrementing end() reaches the largest item")
+            {
+                assert_eq(*--tree.end(), 99);
+            }
+        }
+
+        section("ERASE")
+        {
+            unit_test("erase by key removes every copy")
+            {
+                AvlTree<T> tree;
+
+                for (T item = 0; item < 10; ++item)
+                {
+                    tree.insert(item);
+                    tree.insert(5);
+                }
+
+                assert_eq(tree.erase(5), 11);
+                assert_eq(tree.contains(5), false);
+                assert_eq(tree.size(), 9);
+            }
+
+            unit_test("erase returns the following item")
+            {
+                AvlTree<T> tree;
+
+                for (T item = 0; item < 10; ++item) tree.insert(item);
+
+                auto next = tree.erase(tree.find(3));
+                assert_eq(*next, 4);
+                assert_eq(tree.erase(tree.find(9)) == tree.end(), true);
+            }
+
+            //Erasing a node with two children used to free its successor node
+            unit_test("range erase")
+            {
+                AvlTree<T> tree;
+
+                for (T item = 0; item < 10; ++item) tree.insert(item);
+
+                auto last = tree.find(7);
+                for (auto it = tree.find(2); it != last;) it = tree.erase(it);
+
+                std::multiset<T> expected = { 0, 1, 7, 8, 9 };
+                assert_eq(matches(tree, expected), true);
+            }
+
+            unit_test("iterators to other items stay valid")
+            {
+                AvlTree<T> tree;
+                std::vector<typename AvlTree<T>::const_iterator> positions;
+
+                for (T item = 0; item < 64; ++item) tree.insert(item);
+                for (auto it = tree.begin(); it != tree.end(); ++it) positions.push_back(it);
+
+                bool valid = true;
+
+                for (T item = 0; item < 64; item += 2)
+                {
+                    tree.erase(positions[item]);
+
+                    for (T other = 1; other < 64; other += 2) valid &= *positions[other] == other;
+                }
+
+                assert_eq(valid, true);
+                assert_eq(tree.size(), 32);
+            }
+
+            unit_test("random erase and extract match std::multiset")
+            {
+                AvlTree<T> tree;
+                std::multiset<T> expected;
+                bool agree = true;
+
+                for (size_t i = 0; i < 20000; ++i)
+                {
+                    T item = T(random() % 500);
+
+                    switch (random() % 4)
+                    {
+                        case 0:
+                        case 1:
+                            tree.insert(item);
+                            expected.insert(item);
+                            break;
+
+                        case 2:
+                            agree &= tree.erase(item) == expected.erase(item);
+                            break;
+
+                        default:
+                        {
+                            auto position = tree.lower_bound(item);
+                            auto expectedPosition = expected.lower_bound(item);
+
+                            if (expectedPosition == expected.end()) break;
+
+                            agree &= tree.extract(position) == *expectedPosition;
+                            expected.erase(expectedPosition);
+                        }
+                    }
+                }
+
+                assert_eq(agree, true);
+                assert_eq(matches(tree, expected), true);
+            }
+
+            unit_test("clear")
+            {
+                AvlTree<T> tree;
+
+                for (T item = 0; item < 1000; ++item) tree.insert(item);
+                tree.clear();
+
+                assert_eq(tree.empty(), true);
+                assert_eq(tree.begin() == tree.end(), true);
+            }
+        }
+
+        section("ORDER STATISTICS")
+        {
+            OrderStatisticTree<T> tree;
+            std::multiset<T> expected;
+
+            for (size_t i = 0; i < 3000; ++i)
+            {
+                T item = T(random() % 300);
+
+                if (random() % 3)
+                {
+                    tree.insert(item);
+                    expected.insert(item);
+                }
+
+                else
+                {
+                    auto position = tree.lower_bound(item);
+                    if (position != tree.end())
+                    {
+                        expected.erase(expected.find(*position));
+                        tree.erase(position);
+                    }
+                }
+            }
+
+            unit_test("matches std::multiset")
+            {
+                assert_eq(matches(tree, expected), true);
+            }
+
+            unit_test("rank, select and count")
+            {
+                bool agree = true;
+                size_t index = 0;
+
+                for (auto it = expected.begin(); it != expected.end(); ++it, ++index)
+                    agree &= *tree.select(index) == *it;
+
+                for (T key = -1; key <= 301; ++key)
+                {
+                    agree &= tree.rank(key) == size_t(std::distance(expected.begin(), expected.lower_bound(key)));
+                    agree &= tree.count(key, key + 10) ==
+                             size_t(std::distance(expected.lower_bound(key), expected.lower_bound(key + 10)));
+                }
+
+                assert_eq(agree, true);
+                assert_eq(tree.select(expected.size()) == tree.end(), true);
+            }
+        }
+
+        section("BULK LOADING")
+        {
+            unit_test("from_sorted")
+            {
+                std::vector<T> items;
+                for (size_t i = 0; i < 10000; ++i) items.push_back(T(random() % 3000));
+                std::sort(items.begin(), items.end());
+
+                auto tree = AvlTree<T, CountingInstrumentation>::from_sorted(items);
+
+                assert_eq(matches(tree, std::multiset<T>(items.begin(), items.end())), true);
+                assert_eq(tree.instrumentation().comparisons, 0);
+                assert_eq(tree.instrumentation().allocations, 10000);
+            }
+
+            unit_test("from_unsorted, sequential and parallel")
+            {
+                std::vector<T> items;
+                for (size_t i = 0; i < 200000; ++i) items.push_back(T(random() % 50000));
+
+                std::multiset<T> expected(items.begin(), items.end());
+
+                assert_eq(matches(AvlTree<T>::from_unsorted(items, 1), expected), true);
+                assert_eq(matches(AvlTree<T>::from_unsorted(items, 4), expected), true);
+            }
+
+            unit_test("a loaded tree takes inserts and erases")
+            {
+                std::vector<T> items;
+                for (T item = 0; item < 1000; item += 2) items.push_back(item);
+
+                OrderStatisticTree<T> tree = OrderStatisticTree<T>::from_sorted(items);
+                std::multiset<T> expected(items.begin(), items.end());
+
+                for (T item = 1; item < 1000; item += 4)
+                {
+                    tree.insert(item);
+                    expected.insert(item);
+                    tree.erase(item + 1);
+                    expected.erase(item + 1);
+                }
+
+                assert_eq(matches(tree, expected), true);
+                assert_eq(*tree.select(100), *std::next(expected.begin(), 100));
+            }
+
+            unit_test("empty input")
+            {
+                assert_eq(AvlTree<T>::from_sorted(std::vector<T>()).empty(), true);
+            }
+        }
+
+        section("JOIN AND SPLIT")
+        {
+            unit_test("split and join back")
+            {
+                bool agree = true;
+
+                for (T key = -1; key <= 101; key += 17)
+                {
+                    OrderStatisticTree<T> tree;
+                    std::multiset<T> expected;
+
+                    for (size_t i = 0; i < 500; ++i)
+                    {
+                        T item = T(random() % 100);
+
+                        tree.insert(item);
+                        expected.insert(item);
+                    }
+
+                    auto parts = tree.split(key);
+
+                    agree &= tree.empty();
+                    agree &= matches(parts.first, std::multiset<T>(expected.begin(), expected.lower_bound(key)));
+                    agree &= matches(parts.second, std::multiset<T>(expected.lower_bound(key), expected.end()));
+
+                    OrderStatisticTree<T> joined = OrderStatisticTree<T>::join(std::move(parts.first), std::move(parts.second));
+                    agree &= matches(joined, expected);
+                }
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("split keeps order statistics")
+            {
+                OrderStatisticTree<T> tree;
+                for (T item = 0; item < 1000; ++item) tree.insert(item);
+
+                auto parts = tree.split(300);
+
+                assert_eq(parts.first.size(), 300);
+                assert_eq(parts.second.size(), 700);
+                assert_eq(*parts.second.select(0), 300);
+                assert_eq(parts.second.rank(500), 200);
+            }
+
+            unit_test("join trees of different heights")
+            {
+                AvlTree<T> small, large;
+                std::multiset<T> expected;
+
+                for (T item = 0; item < 3; ++item)
+                {
+                    small.insert(item);
+                    expected.insert(item);
+                }
+
+                for (T item = 3; item < 5000; ++item)
+                {
+                    large.insert(item);
+                    expected.insert(item);
+                }
+
+                assert_eq(matches(AvlTree<T>::join(std::move(small), std::move(large)), expected), true);
+            }
+        }
+
+        section("SET OPERATIONS")
+        {
+            std::set<T> a, b;
+
+            for (size_t i = 0; i < 3000; ++i)
+            {
+                a.insert(T(random() % 5000));
+                b.insert(T(random() % 5000));
+            }
+
+            std::multiset<T> united, common, difference;
+
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::inserter(united, united.end()));
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(common, common.end()));
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(difference, difference.end()));
+
+            for (size_t threads : { 1, 4 })
+            {
+                unit_test(threads == 1 ? "sequential" : "parallel")
+                {
+                    assert_eq(matches(AvlTree<T>::setUnion(AvlTree<T>::from_sorted(a), AvlTree<T>::from_sorted(b), threads), united), true);
+                    assert_eq(matches(AvlTree<T>::setIntersection(AvlTree<T>::from_sorted(a), AvlTree<T>::from_sorted(b), threads), common), true);
+                    assert_eq(matches(AvlTree<T>::setDifference(AvlTree<T>::from_sorted(a), AvlTree<T>::from_sorted(b), threads), difference), true);
+                }
+            }
+
+            unit_test("with an empty tree")
+            {
+                std::multiset<T> none;
+
+                assert_eq(matches(AvlTree<T>::setUnion(AvlTree<T>(), AvlTree<T>::from_sorted(a)), std::multiset<T>(a.begin(), a.end())), true);
+                assert_eq(matches(AvlTree<T>::setIntersection(AvlTree<T>::from_sorted(a), AvlTree<T>()), none), true);
+                assert_eq(matches(AvlTree<T>::setDifference(AvlTree<T>(), AvlTree<T>::from_sorted(b)), none), true);
+            }
+        }
+
+        section("COMPACT TREE")
+        {
+            using PointerTree = CompactAvlTree<T, PointerLinks<T>>;
+            using PooledTree = CompactAvlTree<T, PooledLinks<T>>;
+
+            unit_test("pointer links match std::multiset")
+            {
+                assert_eq(compactMatches<PointerTree>(), true);
+            }
+
+            unit_test("pooled links match std::multiset")
+            {
+                assert_eq(compactMatches<PooledTree>(), true);
+            }
+
+            unit_test("clear")
+            {
+                CompactAvlTree<T> tree;
+
+                for (T item = 0; item < 100000; ++item) tree.insert(item);
+                tree.clear();
+
+                assert_eq(tree.empty(), true);
+                assert_eq(tree.contains(5), false);
+            }
+        }
+
+        section("INSTRUMENTATION")
+        {
+            unit_test("counts rotations and allocations")
+            {
+                AvlTree<T, CountingInstrumentation> tree;
+
+                for (T item = 0; item < 1000; ++item) tree.insert(item);
+
+                assert_eq(tree.instrumentation().allocations, 1000);
+                assert_eq(tree.instrumentation().totalRotations(), tree.instrumentation().rotations[3]);
+                assert_gt(tree.instrumentation().totalRotations(), 0);
+                assert_le(tree.instrumentation().maxDepth, 11);
+            }
+
+            unit_test("concurrent lookups count every comparison")
+            {
+                AvlTree<T, CountingInstrumentation> tree;
+
+                for (T item = 0; item < 1000; ++item) tree.insert(item);
+
+                tree.instrumentation().reset();
+
+                const AvlTree<T, CountingInstrumentation>& shared = tree;
+                std::vector<std::thread> readers;
+
+                for (size_t i = 0; i < 4; ++i)
+                    readers.emplace_back([&shared]() { for (T item = 0; item < 1000; ++item) shared.contains(item); });
+
+                for (auto& reader : readers) reader.join();
+
+                size_t comparisons = tree.instrumentation().comparisons;
+                tree.instrumentation().reset();
+
+                for (T item = 0; item < 1000; ++item) shared.contains(item);
+
+                assert_eq(comparisons, 4 * tree.instrumentation().comparisons);
+            }
+        }
+
+        summary();
+    }
+
+    private:
+
+    std::mt19937 random{ 5489 };
+
+    //True if |tree| holds exactly the items of |expected|, in both directions
+    template <typename Tree>
+    static bool matches(const Tree& tree, const std::multiset<T>& expected)
+    {
+        return tree.size() == expected.size() &&
+               std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()) &&
+               std::equal(tree.rbegin(), tree.rend(), expected.rbegin(), expected.rend());
+    }
+
+    //True if |position| and |expectedPosition| are both past the end or hold the same item
+    template <typename Tree>
+    static bool same(const Tree& tree, typename Tree::const_iterator position,
+                     const std::multiset<T>& expected, typename std::multiset<T>::const_iterator expectedPosition)
+    {
+        if (position == tree.end() || expectedPosition == expected.end())
+            return position == tree.end() && expectedPosition == expected.end();
+
+        return *position == *expectedPosition;
+    }
+
+    //True if random inserts and erases on a |Tree| leave it holding the items std::multiset holds
+    template <typename Tree>
+    bool compactMatches()
+    {
+        Tree tree;
+        std::multiset<T> expected;
+        bool agree = true;
+
+        for (size_t i = 0; i < 20000; ++i)
+        {
+            T item = T(random() % 500);
+
+            if (random() % 3)
+            {
+                tree.insert(item);
+                expected.insert(item);
+            }
+
+            else agree &= tree.erase(item) == expected.erase(item);
+
+            const T* found = tree.lower_bound(item);
+            auto expectedFound = expected.lower_bound(item);
+
+            agree &= found ? expectedFound != expected.end() && *found == *expectedFound : expectedFound == expected.end();
+        }
+
+        std::vector<T> items;
+        tree.forEach([&items](const T& item) { items.push_back(item); });
+
+        return agree && tree.size() == expected.size() && std::equal(items.begin(), items.end(), expected.begin(), expected.end());
+    }
+};
+
+#endif //UNIT_TESTS_HPP
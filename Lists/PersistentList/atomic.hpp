@@ -0,0 +1,193 @@
+/*
+ * Atomic publishing of persistent versions between one writer and many readers.
+ *
+ * The current version lives in one of two slots. Writers build the next version,
+ * store it in the slot readers are not using and then flip |current| to it.
+ * Readers announce themselves on the slot they are about to copy and confirm it
+ * is still current, so they never block, never wait for a writer to finish and
+ * never observe a half written slot. A reader only retries when a publish
+ * landed between its two loads of |current|.
+ *
+ * Copying a version out of a slot bumps reference counts concurrently with other
+ * threads, so the versions must be counted with AtomicCount.
+ *
+ *   plll::Atomic<plll::List<int>> config;
+ *   config.update([](const plll::List<int>& list) { return list.push_front(1); });
+ *   plll::List<int> snapshot = config.load();
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef ATOMIC_HPP
+#define ATOMIC_HPP
+
+namespace plll {
+
+////////////////////////////// SNAPSHOT
+
+//A published version along with its sequence number
+template <typename V>
+struct Snapshot
+{
+    uint64_t version;
+    V value;
+};
+
+////////////////////////////// ATOMIC VERSIONED ROOT
+
+template <typename V>
+class Atomic
+{
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Publishes |initial| as version 0
+        //The last |retained| replaced versions are kept alive for history()
+        explicit Atomic(V initial = V(), size_t retained = 0) : current(0), retained(retained)
+        {
+            slots[0].snapshot = { 0, std::move(initial) };
+        }
+
+        Atomic(const Atomic&) = delete;
+        Atomic& operator=(const Atomic&) = delete;
+
+        //////////////// READERS
+
+        //Returns the current version, never blocks
+        V load() const
+        {
+            return load_versioned().value;
+        }
+
+        //Returns the current version with its sequence number, never blocks
+        Snapshot<V> load_versioned() const
+        {
+            for (;;)
+            {
+                size_t index = current.load();
+                const Slot& slot = slots[index];
+
+                slot.readers.fetch_add(1);
+
+                //the slot may have been handed to a writer before we announced ourselves
+                if (current.load() == index)
+                {
+                    Snapshot<V> snapshot = slot.snapshot;
+                    slot.readers.fetch_sub(1);
+
+                    return snapshot;
+                }
+
+                slot.readers.fetch_sub(1);
+            }
+        }
+
+        //Sequence number of the current version
+        uint64_t version() const
+        {
+            return load_versioned().version;
+        }
+
+        //The replaced versions still retained, newest first
+        std::vector<Snapshot<V>> history() const
+        {
+            std::lock_guard<std::mutex> lock(writer);
+
+            return std::vector<Snapshot<V>>(retired.begin(), retired.end());
+        }
+
+        //////////////// WRITERS
+
+        //Publishes |value| as the next version
+        void store(V value)
+        {
+            std::lock_guard<std::mutex> lock(writer);
+
+            publish(std::move(value));
+        }
+
+        //Publishes |f(current)| as the next version and returns it
+        //Writers are serialized, so |f| always sees the latest version
+        template <typename F>
+        V update(F f)
+        {
+            std::lock_guard<std::mutex> lock(writer);
+
+            V next = f(static_cast<const V&>(slots[current.load()].snapshot.value));
+            publish(next);
+
+            return next;
+        }
+
+        //Publishes |desired| only if the current version is still |expected_version|
+        //True if it was published
+        bool compare_exchange(uint64_t expected_version, V desired)
+        {
+            std::lock_guard<std::mutex> lock(writer);
+
+            if (slots[current.load()].snapshot.version != expected_version) return false;
+
+            publish(std::move(desired));
+
+            return true;
+        }
+
+    private:
+
+        //////////////// SLOT
+
+        //Kept on separate cache lines so readers of one slot do not contend with the other
+        struct alignas(64) Slot
+        {
+            Snapshot<V> snapshot;
+            mutable std::atomic<size_t> readers{0};
+        };
+
+        //////////////// DATA
+
+        Slot slots[2];
+
+        //index of the slot holding the current version
+        std::atomic<size_t> current;
+
+        //serializes writers, readers never take it
+        mutable std::mutex writer;
+
+        //replaced versions, newest first
+        std::deque<Snapshot<V>> retired;
+        size_t retained;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        //Must be called with |writer| held
+        void publish(V value)
+        {
+            size_t index = current.load();
+            Slot& next = slots[1 - index];
+
+            //wait for readers still copying the slot's previous version
+            while (next.readers.load() != 0) std::this_thread::yield();
+
+            next.snapshot = { slots[index].snapshot.version + 1, std::move(value) };
+            current.store(1 - index);
+
+            if (retained)
+            {
+                retired.push_front(slots[index].snapshot);
+                if (retired.size() > retained) retired.pop_back();
+            }
+        }
+};
+
+}
+
+#endif //ATOMIC_HPP
@@ -0,0 +1,169 @@
+/*
+ * Persistent catenable list (Okasaki's catenable list over real-time queues).
+ *
+ * A non-empty list is its first element and a queue of suspended sublists
+ * that follow it. Concatenation just pushes the right list onto the left list's
+ * queue, so concat, push_front and push_back are O(1). pop_front links the
+ * sublists of the removed root back together lazily: each link is suspended
+ * and memoized, which keeps pop_front O(1) amortized even when old versions
+ * are popped again.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <stdexcept>
+
+#include "lazy.hpp"
+#include "queue.hpp"
+
+#ifndef CATENABLE_HPP
+#define CATENABLE_HPP
+
+namespace plll {
+
+template<typename T, typename Policy>
+class CatenableList;
+
+////////////////////////////// CATENABLE NODE
+
+template<typename T, typename Policy = AtomicCount>
+struct CatenableNode : RefCounted<CatenableNode<T, Policy>, Policy>
+{
+    using Children = Queue<Lazy<CatenableList<T, Policy>, Policy>, Policy>;
+
+    T _data;
+
+    //the sublists following |_data|, in order
+    Children _children;
+
+    CatenableNode(const T& data, const Children& children) : _data(data), _children(children) {}
+
+    //Nested sublists form arbitrarily deep chains, they are freed from a flat worklist
+    static void release(const CatenableNode* node)
+    {
+        if (Policy::decrement(node->_count)) release_flat(node);
+    }
+};
+
+////////////////////////////// PERSISTENT CATENABLE LIST
+
+template<typename T, typename Policy = AtomicCount>
+class CatenableList
+{
+    using Node = CatenableNode<T, Policy>;
+    using Suspension = Lazy<CatenableList, Policy>;
+    using Children = typename Node::Children;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty list
+        CatenableList() : list_length(0) {}
+
+        //Creates a list with a single element whose value is |data|
+        explicit CatenableList(const T& data) : root(make_ref<Node>(data, Children())), list_length(1) {}
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of elements in the list
+        size_t length() const
+        {
+            return list_length;
+        }
+
+        //True if the list is empty, otherwise false
+        bool is_empty() const
+        {
+            return !list_length;
+        }
+
+        //Returns the first element in the list
+        //Returns nullptr if the list is empty
+        ValueRef<T, Policy, Node> first() const
+        {
+            return ValueRef<T, Policy, Node>(root);
+        }
+
+        //Returns the first element in the list without touching any reference count
+        //Throws std::out_of_range if the list is empty
+        const T& front() const
+        {
+            if (!root) throw std::out_of_range("plll::CatenableList::front on an empty list");
+
+            return root->_data;
+        }
+
+        //Returns the elements of this list followed by the elements of |other| in O(1)
+        CatenableList concat(const CatenableList& other) const
+        {
+            if (other.is_empty()) return *this;
+            if (is_empty()) return other;
+
+            return link(*this, Suspension::of(other), other.list_length);
+        }
+
+        //Pushes a new element containing |data| to the front of the list
+        CatenableList push_front(const T& data) const
+        {
+            return CatenableList(data).concat(*this);
+        }
+
+        //Pushes a new element containing |data| to the back of the list
+        CatenableList push_back(const T& data) const
+        {
+            return concat(CatenableList(data));
+        }
+
+        //Removes the first element of the list
+        //If the list is empty then nothing will happen
+        CatenableList pop_front() const
+        {
+            if (is_empty()) return *this;
+
+            if (root->_children.is_empty()) return CatenableList();
+
+            return link_all(root->_children, list_length - 1);
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //the first element and the sublists after it, null if the list is empty
+        Ref<Node> root;
+
+        //the number of elements currently in the list
+        size_t list_length;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        //Appends the suspended |tail| of |tail_length| elements to the root's sublists
+        static CatenableList link(const CatenableList& list, const Suspension& tail, size_t tail_length)
+        {
+            CatenableList linked;
+            linked.root = make_ref<Node>(list.root->_data, list.root->_children.push_back(tail));
+            linked.list_length = list.list_length + tail_length;
+
+            return linked;
+        }
+
+        //Links a non-empty queue of sublists holding |length| elements into one list
+        //Only the first link is made now, the rest is suspended until it is reached
+        static CatenableList link_all(const Children& children, size_t length)
+        {
+            const CatenableList& first = children.front().force();
+            Children rest = children.pop_front();
+
+            if (rest.is_empty()) return first;
+
+            size_t rest_length = length - first.list_length;
+            auto tail = Suspension::delay([rest, rest_length]() { return link_all(rest, rest_length); });
+
+            return link(first, tail, rest_length);
+        }
+};
+
+}
+
+#endif //CATENABLE_HPP
@@ -0,0 +1,668 @@
+/*
+ * Persistent sequence backed by a 2-3 finger tree annotated with sizes
+ * (Hinze and Paterson).
+ *
+ * Both ends are reachable through the outer digits, so push and pop at either
+ * end are amortized O(1). Every node caches the number of elements below it,
+ * which lets split, concat, nth, insert_at and remove_at work by descending a
+ * single path, O(log N), instead of copying the prefix the way plll::List does.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "list.hpp"
+
+#ifndef FINGERTREE_HPP
+#define FINGERTREE_HPP
+
+namespace plll {
+
+////////////////////////////// FINGER NODES
+
+template<typename T, typename Policy>
+struct FingerLeaf;
+
+template<typename T, typename Policy>
+struct FingerBranch;
+
+//Either a leaf holding one element or a branch of 2 or 3 subtrees of equal depth
+//A branch always holds at least two elements, so a |_size| of 1 marks a leaf
+template<typename T, typename Policy = AtomicCount>
+struct FingerNode : RefCounted<FingerNode<T, Policy>, Policy>
+{
+    size_t _size;
+
+    explicit FingerNode(size_t size) : _size(size) {}
+
+    bool is_leaf() const
+    {
+        return _size == 1;
+    }
+
+    //Frees the node as its real type once the last reference is dropped
+    static void release(const FingerNode* node)
+    {
+        if (!Policy::decrement(node->_count)) return;
+
+        if (node->is_leaf()) delete static_cast<const FingerLeaf<T, Policy>*>(node);
+        else delete static_cast<const FingerBranch<T, Policy>*>(node);
+    }
+};
+
+template<typename T, typename Policy = AtomicCount>
+struct FingerLeaf : FingerNode<T, Policy>
+{
+    T _data;
+
+    explicit FingerLeaf(const T& data) : FingerNode<T, Policy>(1), _data(data) {}
+};
+
+template<typename T, typename Policy = AtomicCount>
+struct FingerBranch : FingerNode<T, Policy>
+{
+    Ref<FingerNode<T, Policy>> _children[3];
+    size_t _arity;
+
+    FingerBranch(const Ref<FingerNode<T, Policy>>& a, const Ref<FingerNode<T, Policy>>& b)
+        : FingerNode<T, Policy>(a->_size + b->_size), _children{ a, b, nullptr }, _arity(2) {}
+
+    FingerBranch(const Ref<FingerNode<T, Policy>>& a, const Ref<FingerNode<T, Policy>>& b, const Ref<FingerNode<T, Policy>>& c)
+        : FingerNode<T, Policy>(a->_size + b->_size + c->_size), _children{ a, b, c }, _arity(3) {}
+};
+
+////////////////////////////// FINGER LEVEL
+
+//One level of the spine
+//A single tree holds its node in |_prefix[0]| with an empty suffix
+//A deep tree has 1 to 4 nodes in each digit and the next level in |_middle| (null if empty)
+template<typename T, typename Policy = AtomicCount>
+struct FingerLevel : RefCounted<FingerLevel<T, Policy>, Policy>
+{
+    size_t _size = 0;
+
+    Ref<FingerNode<T, Policy>> _prefix[4];
+    size_t _prefix_length = 0;
+
+    Ref<FingerLevel<T, Policy>> _middle;
+
+    Ref<FingerNode<T, Policy>> _suffix[4];
+    size_t _suffix_length = 0;
+
+    bool is_single() const
+    {
+        return _suffix_length == 0;
+    }
+};
+
+////////////////////////////// PERSISTENT SEQUENCE
+
+template<typename T, typename Policy = AtomicCount>
+class Sequence
+{
+    using Node = FingerNode<T, Policy>;
+    using Leaf = FingerLeaf<T, Policy>;
+    using Branch = FingerBranch<T, Policy>;
+    using Level = FingerLevel<T, Policy>;
+
+    using NodeRef = Ref<Node>;
+    using Tree = Ref<Level>;
+
+    //A digit outside of a level, while it is being rebuilt
+    struct Digit
+    {
+        NodeRef items[4];
+        size_t length = 0;
+
+        void push_back(const NodeRef& node)
+        {
+            items[length++] = node;
+        }
+    };
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty sequence
+        Sequence() {}
+
+        //Creates a sequence with a single element whose value is |data|
+        explicit Sequence(const T& data) : root(push_back(Tree(), leaf(data))) {}
+
+        //Creates a sequence holding the elements of [|first|, |last|)
+        template <typename It>
+        static Sequence from_range(It first, It last)
+        {
+            Tree tree;
+
+            for (; first != last; ++first) tree = push_back(tree, leaf(*first));
+
+            return Sequence(tree);
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of elements in the sequence
+        size_t length() const
+        {
+            return size(root);
+        }
+
+        //True if the sequence is empty, otherwise false
+        bool is_empty() const
+        {
+            return !root;
+        }
+
+        //Returns the first element in the sequence
+        //Returns nullptr if the sequence is empty
+        ValueRef<T, Policy, Leaf> first() const
+        {
+            return nth(0);
+        }
+
+        //Returns the last element in the sequence
+        //Returns nullptr if the sequence is empty
+        ValueRef<T, Policy, Leaf> last() const
+        {
+            return is_empty() ? nullptr : nth(length() - 1);
+        }
+
+        //Returns the nth element in the sequence
+        //Returns nullptr if |n| is out of bounds
+        ValueRef<T, Policy, Leaf> nth(size_t n) const
+        {
+            if (n >= length()) return nullptr;
+
+            return ValueRef<T, Policy, Leaf>(Ref<Leaf>(leaf_at(n)));
+        }
+
+        //Returns the nth element in the sequence without touching any reference count
+        //Throws std::out_of_range if |n| is out of bounds
+        const T& at(size_t n) const
+        {
+            if (n >= length()) throw std::out_of_range("plll::Sequence::at index out of bounds");
+
+            return leaf_at(n)->_data;
+        }
+
+        //Pushes a new element containing |data| to the front of the sequence
+        Sequence push_front(const T& data) const
+        {
+            return Sequence(push_front(root, leaf(data)));
+        }
+
+        //Pushes a new element containing |data| to the back of the sequence
+        Sequence push_back(const T& data) const
+        {
+            return Sequence(push_back(root, leaf(data)));
+        }
+
+        //Removes the first element of the sequence
+        //If the sequence is empty then nothing will happen
+        Sequence pop_front() const
+        {
+            if (is_empty()) return *this;
+
+            NodeRef removed;
+            return Sequence(pop_front(root, removed));
+        }
+
+        //Removes the last element of the sequence
+        //If the sequence is empty then nothing will happen
+        Sequence pop_back() const
+        {
+            if (is_empty()) return *this;
+
+            NodeRef removed;
+            return Sequence(pop_back(root, removed));
+        }
+
+        //Returns the elements of this sequence followed by the elements of |other|
+        Sequence concat(const Sequence& other) const
+        {
+            return Sequence(concat(root, std::vector<NodeRef>(), other.root));
+        }
+
+        //Splits the sequence into the first |index| elements and the rest
+        std::pair<Sequence, Sequence> split_at(size_t index) const
+        {
+            if (index == 0) return { Sequence(), *this };
+            if (index >= length()) return { *this, Sequence() };
+
+            Tree left, right;
+            NodeRef split_node;
+            split(root, index, left, split_node, right);
+
+            return { Sequence(left), Sequence(push_front(right, split_node)) };
+        }
+
+        //Inserts |data| at |index| location in the sequence
+        //If index is larger than the sequence's size, then |data| will be pushed to the back
+        Sequence insert_at(size_t index, const T& data) const
+        {
+            if (index >= length()) return push_back(data);
+
+            Tree left, right;
+            NodeRef split_node;
+            split(root, index, left, split_node, right);
+
+            return Sequence(concat(left, { leaf(data), split_node }, right));
+        }
+
+        //Removes the data at |index| in the sequence
+        //If |index| is out of bounds then nothing will happen
+        Sequence remove_at(size_t index) const
+        {
+            if (index >= length()) return *this;
+
+            Tree left, right;
+            NodeRef removed;
+            split(root, index, left, removed, right);
+
+            return Sequence(concat(left, std::vector<NodeRef>(), right));
+        }
+
+        //Replaces the element at |index| with |data|
+        //If |index| is out of bounds then nothing will happen
+        Sequence update(size_t index, const T& data) const
+        {
+            if (index >= length()) return *this;
+
+            Tree left, right;
+            NodeRef removed;
+            split(root, index, left, removed, right);
+
+            return Sequence(concat(left, { leaf(data) }, right));
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //the outermost level, null if the sequence is empty
+        Tree root;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        explicit Sequence(const Tree& root) : root(root) {}
+
+        static NodeRef leaf(const T& data)
+        {
+            return NodeRef(new Leaf(data));
+        }
+
+        static size_t size(const Tree& tree)
+        {
+            return tree ? tree->_size : 0;
+        }
+
+        //Find the leaf at |n|, which must be in bounds
+        Leaf* leaf_at(size_t n) const
+        {
+            Level* level = root.get();
+            Node* node = nullptr;
+
+            //find the node holding |n| on the spine
+            while (!node)
+            {
+                size_t i = 0;
+
+                for (; i < level->_prefix_length && n >= level->_prefix[i]->_size; ++i) n -= level->_prefix[i]->_size;
+
+                if (i < level->_prefix_length)
+                {
+                    node = level->_prefix[i].get();
+                    break;
+                }
+
+                if (n < size(level->_middle))
+                {
+                    level = level->_middle.get();
+                    continue;
+                }
+
+                n -= size(level->_middle);
+
+                for (i = 0; n >= level->_suffix[i]->_size; ++i) n -= level->_suffix[i]->_size;
+
+                node = level->_suffix[i].get();
+            }
+
+            //descend to the leaf
+            while (!node->is_leaf())
+            {
+                auto branch = static_cast<Branch*>(node);
+                size_t i = 0;
+
+                for (; n >= branch->_children[i]->_size; ++i) n -= branch->_children[i]->_size;
+
+                node = branch->_children[i].get();
+            }
+
+            return static_cast<Leaf*>(node);
+        }
+
+        //////////////// LEVEL CONSTRUCTION
+
+        static Tree single(const NodeRef& node)
+        {
+            auto level = make_ref<Level>();
+            level->_prefix[0] = node;
+            level->_prefix_length = 1;
+            level->_size = node->_size;
+
+            return level;
+        }
+
+        static Tree deep(const Digit& prefix, const Tree& middle, const Digit& suffix)
+        {
+            auto level = make_ref<Level>();
+            level->_size = size(middle);
+
+            for (size_t i = 0; i < prefix.length; ++i)
+            {
+                level->_prefix[i] = prefix.items[i];
+                level->_size += prefix.items[i]->_size;
+            }
+
+            for (size_t i = 0; i < suffix.length; ++i)
+            {
+                level->_suffix[i] = suffix.items[i];
+                level->_size += suffix.items[i]->_size;
+            }
+
+            level->_prefix_length = prefix.length;
+            level->_middle = middle;
+            level->_suffix_length = suffix.length;
+
+            return level;
+        }
+
+        static Digit prefix_of(const Level* level)
+        {
+            Digit digit;
+            for (size_t i = 0; i < level->_prefix_length; ++i) digit.push_back(level->_prefix[i]);
+            return digit;
+        }
+
+        static Digit suffix_of(const Level* level)
+        {
+            Digit digit;
+            for (size_t i = 0; i < level->_suffix_length; ++i) digit.push_back(level->_suffix[i]);
+            return digit;
+        }
+
+        static Digit children_of(const NodeRef& node)
+        {
+            auto branch = static_cast<const Branch*>(node.get());
+
+            Digit digit;
+            for (size_t i = 0; i < branch->_arity; ++i) digit.push_back(branch->_children[i]);
+            return digit;
+        }
+
+        static Tree from_digit(const Digit& digit)
+        {
+            Tree tree;
+            for (size_t i = 0; i < digit.length; ++i) tree = push_back(tree, digit.items[i]);
+            return tree;
+        }
+
+        //A deep level whose prefix may have been emptied, borrowing from the middle if so
+        static Tree deep_left(const Digit& prefix, const Tree& middle, const Digit& suffix)
+        {
+            if (prefix.length) return deep(prefix, middle, suffix);
+            if (!middle) return from_digit(suffix);
+
+            NodeRef first;
+            Tree rest = pop_front(middle, first);
+
+            return deep(children_of(first), rest, suffix);
+        }
+
+        //A deep level whose suffix may have been emptied, borrowing from the middle if so
+        static Tree deep_right(const Digit& prefix, const Tree& middle, const Digit& suffix)
+        {
+            if (suffix.length) return deep(prefix, middle, suffix);
+            if (!middle) return from_digit(prefix);
+
+            NodeRef last;
+            Tree rest = pop_back(middle, last);
+
+            return deep(prefix, rest, children_of(last));
+        }
+
+        //////////////// ENDS
+
+        static Tree push_front(const Tree& tree, const NodeRef& node)
+        {
+            if (!tree) return single(node);
+
+            if (tree->is_single())
+            {
+                Digit prefix, suffix;
+                prefix.push_back(node);
+                suffix.push_back(tree->_prefix[0]);
+
+                return deep(prefix, nullptr, suffix);
+            }
+
+            Digit prefix;
+            prefix.push_back(node);
+
+            //a full prefix pushes three of its nodes down a level
+            if (tree->_prefix_length == 4)
+            {
+                prefix.push_back(tree->_prefix[0]);
+                NodeRef down(new Branch(tree->_prefix[1], tree->_prefix[2], tree->_prefix[3]));
+
+                return deep(prefix, push_front(tree->_middle, down), suffix_of(tree.get()));
+            }
+
+            for (size_t i = 0; i < tree->_prefix_length; ++i) prefix.push_back(tree->_prefix[i]);
+
+            return deep(prefix, tree->_middle, suffix_of(tree.get()));
+        }
+
+        static Tree push_back(const Tree& tree, const NodeRef& node)
+        {
+            if (!tree) return single(node);
+
+            if (tree->is_single())
+            {
+                Digit prefix, suffix;
+                prefix.push_back(tree->_prefix[0]);
+                suffix.push_back(node);
+
+                return deep(prefix, nullptr, suffix);
+            }
+
+            Digit suffix;
+
+            //a full suffix pushes three of its nodes down a level
+            if (tree->_suffix_length == 4)
+            {
+                NodeRef down(new Branch(tree->_suffix[0], tree->_suffix[1], tree->_suffix[2]));
+                suffix.push_back(tree->_suffix[3]);
+                suffix.push_back(node);
+
+                return deep(prefix_of(tree.get()), push_back(tree->_middle, down), suffix);
+            }
+
+            for (size_t i = 0; i < tree->_suffix_length; ++i) suffix.push_back(tree->_suffix[i]);
+            suffix.push_back(node);
+
+            return deep(prefix_of(tree.get()), tree->_middle, suffix);
+        }
+
+        //Removes the first node of a non-empty |tree| into |first|
+        static Tree pop_front(const Tree& tree, NodeRef& first)
+        {
+            first = tree->_prefix[0];
+
+            if (tree->is_single()) return nullptr;
+
+            Digit prefix;
+            for (size_t i = 1; i < tree->_prefix_length; ++i) prefix.push_back(tree->_prefix[i]);
+
+            return deep_left(prefix, tree->_middle, suffix_of(tree.get()));
+        }
+
+        //Removes the last node of a non-empty |tree| into |last|
+        static Tree pop_back(const Tree& tree, NodeRef& last)
+        {
+            if (tree->is_single())
+            {
+                last = tree->_prefix[0];
+                return nullptr;
+            }
+
+            last = tree->_suffix[tree->_suffix_length - 1];
+
+            Digit suffix;
+            for (size_t i = 0; i + 1 < tree->_suffix_length; ++i) suffix.push_back(tree->_suffix[i]);
+
+            return deep_right(prefix_of(tree.get()), tree->_middle, suffix);
+        }
+
+        //////////////// CONCATENATION
+
+        //Groups 2 or more nodes of equal depth into branches of 2 or 3
+        static std::vector<NodeRef> group(const std::vector<NodeRef>& nodes)
+        {
+            std::vector<NodeRef> groups;
+            size_t i = 0, remaining = nodes.size();
+
+            for (; remaining > 4; i += 3, remaining -= 3)
+                groups.push_back(NodeRef(new Branch(nodes[i], nodes[i + 1], nodes[i + 2])));
+
+            if (remaining == 2) groups.push_back(NodeRef(new Branch(nodes[i], nodes[i + 1])));
+
+            else if (remaining == 3) groups.push_back(NodeRef(new Branch(nodes[i], nodes[i + 1], nodes[i + 2])));
+
+            else
+            {
+                groups.push_back(NodeRef(new Branch(nodes[i], nodes[i + 1])));
+                groups.push_back(NodeRef(new Branch(nodes[i + 2], nodes[i + 3])));
+            }
+
+            return groups;
+        }
+
+        //Joins |left|, the loose |nodes| and |right|, all of the same depth
+        static Tree concat(const Tree& left, const std::vector<NodeRef>& nodes, const Tree& right)
+        {
+            if (!left)
+            {
+                Tree tree = right;
+                for (size_t i = nodes.size(); i > 0; --i) tree = push_front(tree, nodes[i - 1]);
+                return tree;
+            }
+
+            if (!right)
+            {
+                Tree tree = left;
+                for (const auto& node : nodes) tree = push_back(tree, node);
+                return tree;
+            }
+
+            if (left->is_single())
+                return push_front(concat(nullptr, nodes, right), left->_prefix[0]);
+
+            if (right->is_single())
+                return push_back(concat(left, nodes, nullptr), right->_prefix[0]);
+
+            //the inner digits and the loose nodes sink into the joined middle
+            std::vector<NodeRef> inner;
+            for (size_t i = 0; i < left->_suffix_length; ++i) inner.push_back(left->_suffix[i]);
+            inner.insert(inner.end(), nodes.begin(), nodes.end());
+            for (size_t i = 0; i < right->_prefix_length; ++i) inner.push_back(right->_prefix[i]);
+
+            Tree middle = concat(left->_middle, group(inner), right->_middle);
+
+            return deep(prefix_of(left.get()), middle, suffix_of(right.get()));
+        }
+
+        //////////////// SPLITTING
+
+        //Splits |digit| around the node holding position |index|
+        //|index| is left relative to |split_node|
+        static void split(const Digit& digit, size_t& index, Digit& left, NodeRef& split_node, Digit& right)
+        {
+            size_t i = 0;
+
+            for (; index >= digit.items[i]->_size; ++i)
+            {
+                index -= digit.items[i]->_size;
+                left.push_back(digit.items[i]);
+            }
+
+            split_node = digit.items[i];
+
+            for (++i; i < digit.length; ++i) right.push_back(digit.items[i]);
+        }
+
+        //Splits a non-empty |tree| around the node holding position |index|, which must be in bounds
+        //|index| is left relative to |split_node|
+        static void split(const Tree& tree, size_t& index, Tree& left, NodeRef& split_node, Tree& right)
+        {
+            if (tree->is_single())
+            {
+                split_node = tree->_prefix[0];
+                left = right = nullptr;
+                return;
+            }
+
+            Digit prefix = prefix_of(tree.get());
+            Digit suffix = suffix_of(tree.get());
+
+            size_t prefix_size = 0;
+            for (size_t i = 0; i < prefix.length; ++i) prefix_size += prefix.items[i]->_size;
+
+            //the position is in the prefix
+            if (index < prefix_size)
+            {
+                Digit before, after;
+                split(prefix, index, before, split_node, after);
+
+                left = from_digit(before);
+                right = deep_left(after, tree->_middle, suffix);
+                return;
+            }
+
+            index -= prefix_size;
+
+            //the position is in the middle, split it and then the branch it lands in
+            if (index < size(tree->_middle))
+            {
+                Tree middle_left, middle_right;
+                NodeRef branch;
+                split(tree->_middle, index, middle_left, branch, middle_right);
+
+                Digit before, after;
+                split(children_of(branch), index, before, split_node, after);
+
+                left = deep_right(prefix, middle_left, before);
+                right = deep_left(after, middle_right, suffix);
+                return;
+            }
+
+            index -= size(tree->_middle);
+
+            //the position is in the suffix
+            Digit before, after;
+            split(suffix, index, before, split_node, after);
+
+            left = deep_right(prefix, tree->_middle, before);
+            right = from_digit(after);
+        }
+};
+
+}
+
+#endif //FINGERTREE_HPP
@@ -0,0 +1,768 @@
+/*
+ * Persistent hash array mapped trie (Bagwell), as plll::Map and plll::Set.
+ *
+ * Keys are placed by their hash, 5 bits per level, so every lookup and update
+ * descends at most log32 N nodes. A node only stores the slots that are used:
+ * one bitmap marks the slots holding a key and another the slots holding a
+ * child node, and a slot's position in the packed arrays is the number of bits
+ * set below it in its bitmap. Keys whose hashes are fully equal end up together
+ * in a collision node below the last level.
+ *
+ * Removing keys keeps the trie canonical: a child left with a single key is
+ * pulled back into its parent, so a map only ever holds as many nodes as its
+ * keys need no matter how it was built.
+ *
+ * Updates copy the path from the root to the changed slot and share the rest
+ * with the previous version. A Transient edits nodes it owns alone in place, so
+ * loading many keys at once only copies each node once.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ref.hpp"
+
+#ifndef HAMT_HPP
+#define HAMT_HPP
+
+namespace plll {
+
+////////////////////////////// TRIE NODE
+
+//A bitmap-compressed node, or a collision node below the last level, where both bitmaps are unused
+template<typename K, typename V, typename Policy = AtomicCount>
+struct HamtNode : RefCounted<HamtNode<K, V, Policy>, Policy>
+{
+    //slots holding a key, and slots holding a child node
+    uint32_t _datamap = 0;
+    uint32_t _nodemap = 0;
+
+    std::vector<std::pair<K, V>> _entries;
+    std::vector<Ref<HamtNode>> _children;
+
+    HamtNode() {}
+
+    //The reference count is not copied, the copy starts unshared
+    HamtNode(const HamtNode& other)
+        : _datamap(other._datamap), _nodemap(other._nodemap), _entries(other._entries), _children(other._children) {}
+};
+
+////////////////////////////// PERSISTENT HASH MAP
+
+template<typename K, typename V, typename Policy = AtomicCount, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+class Map
+{
+    using NodeT = HamtNode<K, V, Policy>;
+
+    static constexpr unsigned BITS = 5;
+    static constexpr unsigned HASH_BITS = sizeof(size_t) * 8;
+
+    //levels of bitmap nodes plus the collision level
+    static constexpr unsigned MAX_DEPTH = (HASH_BITS + BITS - 1) / BITS + 1;
+
+    public:
+
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+
+        //////////////// ITERATOR
+
+        //Visits every key once, in no particular order
+        class const_iterator
+        {
+            friend class Map;
+
+            public:
+
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::pair<K, V>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const value_type*;
+                using reference = const value_type&;
+
+                const_iterator() : depth(0) {}
+
+                reference operator*() const { return top().node->_entries[top().entry]; }
+
+                pointer operator->() const { return &**this; }
+
+                const_iterator& operator++()
+                {
+                    ++top().entry;
+                    settle();
+                    return *this;
+                }
+
+                const_iterator operator++(int)
+                {
+                    const_iterator previous = *this;
+                    ++*this;
+                    return previous;
+                }
+
+                bool operator==(const const_iterator& other) const
+                {
+                    if (depth != other.depth) return false;
+                    return !depth || (top().node == other.top().node && top().entry == other.top().entry);
+                }
+
+                bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+            private:
+
+                struct Frame
+                {
+                    const NodeT* node;
+                    size_t entry;
+                    size_t child;
+                };
+
+                //the path from the root to the node holding the current key, empty at the end
+                std::array<Frame, MAX_DEPTH> frames;
+                size_t depth;
+
+                explicit const_iterator(const NodeT* root) : depth(0)
+                {
+                    if (root) frames[depth++] = { root, 0, 0 };
+                    settle();
+                }
+
+                Frame& top() { return frames[depth - 1]; }
+
+                const Frame& top() const { return frames[depth - 1]; }
+
+                //Moves to the next key at or after the current position
+                void settle()
+                {
+                    while (depth)
+                    {
+                        Frame& frame = top();
+
+                        if (frame.entry < frame.node->_entries.size()) return;
+
+                        if (frame.child < frame.node->_children.size())
+                        {
+                            const NodeT* child = frame.node->_children[frame.child++].get();
+                            frames[depth++] = { child, 0, 0 };
+                        }
+
+                        else --depth;
+                    }
+                }
+        };
+
+        const_iterator begin() const
+        {
+            return const_iterator(root.get());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator();
+        }
+
+        //////////////// TRANSIENT BUILDER
+
+        //A batch-mutable map, nodes it owns alone are edited in place instead of copied
+        //persistent() freezes the nodes into an immutable Map in O(1) and empties the builder
+        //Pointers returned by get() are invalidated by the next update
+        class Transient
+        {
+            friend class Map;
+
+            public:
+
+                //Creates an empty builder
+                Transient() : count(0) {}
+
+                //Returns the number of keys in the builder
+                size_t size() const
+                {
+                    return count;
+                }
+
+                //Returns the value of |key|, or nullptr if it is absent
+                const V* get(const K& key) const
+                {
+                    return Map::find(root.get(), key);
+                }
+
+                //Sets |key| to |value| in place
+                Transient& assoc(const K& key, const V& value)
+                {
+                    bool added = false;
+                    root = Map::assoc(root, 0, Hash()(key), key, value, added, true);
+                    count += added;
+
+                    return *this;
+                }
+
+                //Removes |key| in place, if it is present
+                Transient& dissoc(const K& key)
+                {
+                    bool removed = false;
+                    root = Map::dissoc(root, 0, Hash()(key), key, removed, true);
+                    count -= removed;
+
+                    return *this;
+                }
+
+                //Freezes the builder's nodes into a persistent map and empties the builder
+                Map persistent()
+                {
+                    Map frozen;
+                    frozen.root = std::move(root);
+                    frozen.count = count;
+
+                    root = nullptr;
+                    count = 0;
+
+                    return frozen;
+                }
+
+            private:
+
+                Ref<NodeT> root;
+                size_t count;
+        };
+
+        //Returns a builder starting from this map in O(1), nodes are copied the first time they are edited
+        Transient transient() const &
+        {
+            Transient builder;
+            builder.root = root;
+            builder.count = count;
+
+            return builder;
+        }
+
+        //Returns a builder over this map, leaving it empty
+        //Nodes no other version shares are edited in place without being copied
+        Transient transient() &&
+        {
+            Transient builder;
+            builder.root = std::move(root);
+            builder.count = count;
+
+            root = nullptr;
+            count = 0;
+
+            return builder;
+        }
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty map
+        Map() : count(0) {}
+
+        //Creates a map holding the key/value pairs of [|first|, |last|), later pairs win
+        template <typename It>
+        static Map from_range(It first, It last)
+        {
+            Transient builder;
+
+            for (; first != last; ++first) builder.assoc(first->first, first->second);
+
+            return builder.persistent();
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of keys
+        size_t size() const
+        {
+            return count;
+        }
+
+        bool is_empty() const
+        {
+            return !count;
+        }
+
+        //Returns the value of |key|, or nullptr if it is absent
+        //The pointer is valid as long as this map is
+        const V* get(const K& key) const
+        {
+            return find(root.get(), key);
+        }
+
+        //Returns the value of |key|
+        //Throws std::out_of_range if it is absent
+        const V& at(const K& key) const
+        {
+            const V* value = get(key);
+            if (!value) throw std::out_of_range("plll::Map::at key not found");
+
+            return *value;
+        }
+
+        bool contains(const K& key) const
+        {
+            return get(key) != nullptr;
+        }
+
+        //Returns a new map with |key| set to |value|
+        Map assoc(const K& key, const V& value) const
+        {
+            Map new_map;
+            bool added = false;
+
+            new_map.root = assoc(root, 0, Hash()(key), key, value, added, false);
+            new_map.count = count + added;
+
+            return new_map;
+        }
+
+        //Returns a new map without |key|
+        //If |key| is absent then the same version is returned
+        Map dissoc(const K& key) const
+        {
+            Map new_map;
+            bool removed = false;
+
+            new_map.root = dissoc(root, 0, Hash()(key), key, removed, false);
+            new_map.count = count - removed;
+
+            return new_map;
+        }
+
+        //True if both maps are the same version, O(1)
+        bool identical_to(const Map& other) const
+        {
+            return root == other.root;
+        }
+
+    private:
+
+        //////////////// DATA
+
+        Ref<NodeT> root;
+        size_t count;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        static unsigned slot(size_t hash, unsigned shift)
+        {
+            return (hash >> shift) & ((1u << BITS) - 1);
+        }
+
+        //The position of |bit| among the bits set in |map|
+        static size_t index(uint32_t map, uint32_t bit)
+        {
+            return __builtin_popcount(map & (bit - 1));
+        }
+
+        static const V* find(const NodeT* node, const K& key)
+        {
+            size_t hash = Hash()(key);
+            Equal equal;
+
+            for (unsigned shift = 0; node; shift += BITS)
+            {
+                if (shift >= HASH_BITS)
+                {
+                    for (const auto& entry : node->_entries)
+                        if (equal(entry.first, key)) return &entry.second;
+
+                    return nullptr;
+                }
+
+                uint32_t bit = 1u << slot(hash, shift);
+
+                if (node->_datamap & bit)
+                {
+                    const auto& entry = node->_entries[index(node->_datamap, bit)];
+                    return equal(entry.first, key) ? &entry.second : nullptr;
+                }
+
+                if (!(node->_nodemap & bit)) return nullptr;
+
+                node = node->_children[index(node->_nodemap, bit)].get();
+            }
+
+            return nullptr;
+        }
+
+        //Returns |node| itself when |edit| is set and nothing else refers to it, a copy otherwise
+        static Ref<NodeT> writable(const Ref<NodeT>& node, bool edit)
+        {
+            if (!node) return make_ref<NodeT>();
+            if (edit && node->use_count() == 1) return node;
+
+            return make_ref<NodeT>(*node);
+        }
+
+        //A node at |shift| holding two keys whose hashes differ at or below it
+        static Ref<NodeT> merge(unsigned shift, size_t hash1, std::pair<K, V> entry1, size_t hash2, std::pair<K, V> entry2)
+        {
+            auto node = make_ref<NodeT>();
+
+            if (shift >= HASH_BITS)
+            {
+                node->_entries.push_back(std::move(entry1));
+                node->_entries.push_back(std::move(entry2));
+                return node;
+            }
+
+            unsigned slot1 = slot(hash1, shift);
+            unsigned slot2 = slot(hash2, shift);
+
+            if (slot1 == slot2)
+            {
+                node->_nodemap = 1u << slot1;
+                node->_children.push_back(merge(shift + BITS, hash1, std::move(entry1), hash2, std::move(entry2)));
+                return node;
+            }
+
+            node->_datamap = (1u << slot1) | (1u << slot2);
+
+            if (slot1 > slot2) std::swap(entry1, entry2);
+
+            node->_entries.push_back(std::move(entry1));
+            node->_entries.push_back(std::move(entry2));
+
+            return node;
+        }
+
+        static Ref<NodeT> assoc(const Ref<NodeT>& node, unsigned shift, size_t hash, const K& key, const V& value, bool& added, bool edit)
+        {
+            Equal equal;
+            auto target = writable(node, edit);
+
+            if (shift >= HASH_BITS)
+            {
+                for (auto& entry : target->_entries)
+                {
+                    if (equal(entry.first, key))
+                    {
+                        entry.second = value;
+                        return target;
+                    }
+                }
+
+                target->_entries.emplace_back(key, value);
+                added = true;
+
+                return target;
+            }
+
+            uint32_t bit = 1u << slot(hash, shift);
+
+            if (target->_datamap & bit)
+            {
+                size_t at = index(target->_datamap, bit);
+                auto& entry = target->_entries[at];
+
+                if (equal(entry.first, key))
+                {
+                    entry.second = value;
+                    return target;
+                }
+
+                //the slot's key moves down into a new child together with |key|
+                size_t entry_hash = Hash()(entry.first);
+                auto child = merge(shift + BITS, entry_hash, std::move(entry), hash, { key, value });
+
+                target->_entries.erase(target->_entries.begin() + at);
+                target->_datamap ^= bit;
+
+                target->_nodemap |= bit;
+                target->_children.insert(target->_children.begin() + index(target->_nodemap, bit), child);
+
+                added = true;
+
+                return target;
+            }
+
+            if (target->_nodemap & bit)
+            {
+                auto& child = target->_children[index(target->_nodemap, bit)];
+                child = assoc(child, shift + BITS, hash, key, value, added, edit);
+
+                return target;
+            }
+
+            target->_datamap |= bit;
+            target->_entries.emplace(target->_entries.begin() + index(target->_datamap, bit), key, value);
+            added = true;
+
+            return target;
+        }
+
+        //Returns null when the last key of |node| is removed
+        static Ref<NodeT> dissoc(const Ref<NodeT>& node, unsigned shift, size_t hash, const K& key, bool& removed, bool edit)
+        {
+            if (!node) return node;
+
+            Equal equal;
+
+            if (shift >= HASH_BITS)
+            {
+                for (size_t i = 0; i < node->_entries.size(); ++i)
+                {
+                    if (!equal(node->_entries[i].first, key)) continue;
+
+                    auto target = writable(node, edit);
+                    target->_entries.erase(target->_entries.begin() + i);
+                    removed = true;
+
+                    return target->_entries.empty() ? nullptr : target;
+                }
+
+                return node;
+            }
+
+            uint32_t bit = 1u << slot(hash, shift);
+
+            if (node->_datamap & bit)
+            {
+                size_t at = index(node->_datamap, bit);
+                if (!equal(node->_entries[at].first, key)) return node;
+
+                auto target = writable(node, edit);
+                target->_entries.erase(target->_entries.begin() + at);
+                target->_datamap ^= bit;
+                removed = true;
+
+                return target->_entries.empty() && target->_children.empty() ? nullptr : target;
+            }
+
+            if (!(node->_nodemap & bit)) return node;
+
+            //the child may only be edited in place if no other version reaches it through this node
+            size_t at = index(node->_nodemap, bit);
+            auto child = dissoc(node->_children[at], shift + BITS, hash, key, removed, edit && node->use_count() == 1);
+
+            if (!removed) return node;
+
+            auto target = writable(node, edit);
+
+            if (!child)
+            {
+                target->_children.erase(target->_children.begin() + at);
+                target->_nodemap ^= bit;
+            }
+
+            //a child left with a single key gives it back to this node
+            else if (child->_children.empty() && child->_entries.size() == 1)
+            {
+                target->_children.erase(target->_children.begin() + at);
+                target->_nodemap ^= bit;
+
+                target->_datamap |= bit;
+                target->_entries.insert(target->_entries.begin() + index(target->_datamap, bit), child->_entries.front());
+            }
+
+            else target->_children[at] = child;
+
+            return target;
+        }
+};
+
+////////////////////////////// PERSISTENT HASH SET
+
+template<typename K, typename Policy = AtomicCount, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+class Set
+{
+    struct Present {};
+
+    using Keys = Map<K, Present, Policy, Hash, Equal>;
+
+    public:
+
+        using key_type = K;
+        using value_type = K;
+
+        //////////////// ITERATOR
+
+        //Visits every key once, in no particular order
+        class const_iterator
+        {
+            friend class Set;
+
+            public:
+
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = K;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const K*;
+                using reference = const K&;
+
+                const_iterator() {}
+
+                reference operator*() const { return position->first; }
+
+                pointer operator->() const { return &position->first; }
+
+                const_iterator& operator++()
+                {
+                    ++position;
+                    return *this;
+                }
+
+                const_iterator operator++(int)
+                {
+                    const_iterator previous = *this;
+                    ++position;
+                    return previous;
+                }
+
+                bool operator==(const const_iterator& other) const { return position == other.position; }
+
+                bool operator!=(const const_iterator& other) const { return position != other.position; }
+
+            private:
+
+                typename Keys::const_iterator position;
+
+                explicit const_iterator(typename Keys::const_iterator position) : position(position) {}
+        };
+
+        const_iterator begin() const
+        {
+            return const_iterator(keys.begin());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(keys.end());
+        }
+
+        //////////////// TRANSIENT BUILDER
+
+        //A batch-mutable set, nodes it owns alone are edited in place instead of copied
+        //persistent() freezes the nodes into an immutable Set in O(1) and empties the builder
+        class Transient
+        {
+            friend class Set;
+
+            public:
+
+                //Returns the number of keys in the builder
+                size_t size() const
+                {
+                    return keys.size();
+                }
+
+                bool contains(const K& key) const
+                {
+                    return keys.get(key) != nullptr;
+                }
+
+                //Adds |key| in place
+                Transient& insert(const K& key)
+                {
+                    keys.assoc(key, Present());
+                    return *this;
+                }
+
+                //Removes |key| in place, if it is present
+                Transient& erase(const K& key)
+                {
+                    keys.dissoc(key);
+                    return *this;
+                }
+
+                //Freezes the builder's nodes into a persistent set and empties the builder
+                Set persistent()
+                {
+                    return Set(keys.persistent());
+                }
+
+            private:
+
+                typename Keys::Transient keys;
+        };
+
+        //Returns a builder starting from this set in O(1), nodes are copied the first time they are edited
+        Transient transient() const &
+        {
+            Transient builder;
+            builder.keys = keys.transient();
+
+            return builder;
+        }
+
+        //Returns a builder over this set, leaving it empty
+        Transient transient() &&
+        {
+            Transient builder;
+            builder.keys = std::move(keys).transient();
+
+            return builder;
+        }
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty set
+        Set() {}
+
+        //Creates a set holding the keys of [|first|, |last|)
+        template <typename It>
+        static Set from_range(It first, It last)
+        {
+            Transient builder;
+
+            for (; first != last; ++first) builder.insert(*first);
+
+            return builder.persistent();
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of keys
+        size_t size() const
+        {
+            return keys.size();
+        }
+
+        bool is_empty() const
+        {
+            return keys.is_empty();
+        }
+
+        bool contains(const K& key) const
+        {
+            return keys.contains(key);
+        }
+
+        //Returns a new set with |key| added
+        Set insert(const K& key) const
+        {
+            return Set(keys.assoc(key, Present()));
+        }
+
+        //Returns a new set without |key|
+        Set erase(const K& key) const
+        {
+            return Set(keys.dissoc(key));
+        }
+
+        //True if both sets are the same version, O(1)
+        bool identical_to(const Set& other) const
+        {
+            return keys.identical_to(other.keys);
+        }
+
+    private:
+
+        //////////////// DATA
+
+        Keys keys;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        explicit Set(const Keys& keys) : keys(keys) {}
+};
+
+}
+
+#endif //HAMT_HPP
@@ -0,0 +1,164 @@
+/*
+ * Hash-consing node factory for plll::List.
+ *
+ * An Interner keeps one node per distinct (value, next node) pair. Building
+ * lists through it makes equal suffixes physically shared no matter where they
+ * came from, so two interned lists are equal exactly when they are the same
+ * version, which identical_to() checks in O(1).
+ *
+ * Only lists built by the same Interner are deduplicated, and only through its
+ * own functions: push_back, insert_at and the other List operations still
+ * create fresh nodes, which push_front interns before building on them. An
+ * Interner is not thread safe.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "list.hpp"
+
+#ifndef INTERN_HPP
+#define INTERN_HPP
+
+namespace plll {
+
+////////////////////////////// INTERNER
+
+template<typename T, typename Policy = AtomicCount, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>>
+class Interner
+{
+    using NodeT = Node<T, Policy>;
+
+    public:
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns |list| with |data| in front, reusing the node if that pair was seen before
+        //A |list| not built by this interner is interned first, so every interned node
+        //is followed by interned nodes only
+        List<T, Policy> push_front(const List<T, Policy>& list, const T& data)
+        {
+            if (list.head && find(list.head.get()) == table.end()) return push_front(intern(list), data);
+
+            List<T, Policy> new_list;
+            new_list.head = node_for(data, list.head);
+            new_list.tail = list.tail ? list.tail : new_list.head;
+            new_list.list_length = list.list_length + 1;
+
+            return new_list;
+        }
+
+        //Returns the interned copy of any |list|
+        List<T, Policy> intern(const List<T, Policy>& list)
+        {
+            return from_range(list.begin(), list.end());
+        }
+
+        //Returns the interned list holding the elements of [|first|, |last|)
+        template <typename It>
+        List<T, Policy> from_range(It first, It last)
+        {
+            std::vector<T> items(first, last);
+            List<T, Policy> list;
+
+            for (size_t i = items.size(); i > 0; --i) list = push_front(list, items[i - 1]);
+
+            return list;
+        }
+
+        //The number of distinct nodes held
+        size_t size() const
+        {
+            return table.size();
+        }
+
+        //Drops the nodes no list refers to anymore, only the table was keeping them alive
+        //Returns the number of nodes dropped
+        size_t collect()
+        {
+            size_t dropped = 0;
+
+            for (auto entry = table.begin(); entry != table.end();)
+            {
+                if (entry->second->use_count() != 1)
+                {
+                    ++entry;
+                    continue;
+                }
+
+                //dropping a node can leave its successor referenced only by the table
+                //the successor is looked up first, dropping the node may free one outside the table
+                auto successor = find(entry->second->_next.get());
+                entry = table.erase(entry);
+                ++dropped;
+
+                while (successor != table.end() && successor->second->use_count() == 1)
+                {
+                    auto after = find(successor->second->_next.get());
+
+                    //erasing the entry the outer loop is about to visit must not invalidate it
+                    if (successor == entry) entry = table.erase(successor);
+                    else table.erase(successor);
+
+                    ++dropped;
+                    successor = after;
+                }
+            }
+
+            return dropped;
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //every node keyed by the combined hash of its value and its successor
+        std::unordered_multimap<size_t, Ref<NodeT>> table;
+
+        Hash hash;
+        Equal equal;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        size_t key(const T& data, const NodeT* next) const
+        {
+            size_t seed = hash(data);
+            return seed ^ (std::hash<const NodeT*>()(next) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+        }
+
+        //Returns the unique node for (|data|, |next|), creating it on first use
+        Ref<NodeT> node_for(const T& data, const Ref<NodeT>& next)
+        {
+            size_t k = key(data, next.get());
+            auto range = table.equal_range(k);
+
+            for (auto entry = range.first; entry != range.second; ++entry)
+                if (entry->second->_next == next && equal(entry->second->_data, data)) return entry->second;
+
+            auto node = make_ref<NodeT>(data);
+            node->_next = next;
+            table.emplace(k, node);
+
+            return node;
+        }
+
+        //The table entry holding |node|, end() if |node| is null or was not built by this interner
+        typename std::unordered_multimap<size_t, Ref<NodeT>>::iterator find(const NodeT* node)
+        {
+            if (!node) return table.end();
+
+            auto range = table.equal_range(key(node->_data, node->_next.get()));
+
+            for (auto entry = range.first; entry != range.second; ++entry)
+                if (entry->second.get() == node) return entry;
+
+            return table.end();
+        }
+};
+
+}
+
+#endif //INTERN_HPP
@@ -0,0 +1,142 @@
+/*
+ * Memoized suspensions for the lazy persistent structures.
+ * A Lazy holds a computation that runs at most once, the first time it is
+ * forced. Every copy shares the same cell, so the result is computed once and
+ * then seen by every version and every thread holding the suspension.
+ *
+ * A suspension may name another one its computation reads. Forcing it forces
+ * that chain of pending dependencies from the innermost out, so long chains,
+ * such as a stream dropped one element at a time, never nest their forcing.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ref.hpp"
+
+#ifndef LAZY_HPP
+#define LAZY_HPP
+
+namespace plll {
+
+////////////////////////////// LAZY CELL
+
+template<typename V, typename Policy = AtomicCount>
+struct LazyCell : RefCounted<LazyCell<V, Policy>, Policy>
+{
+    //held while the computation runs, and while reading |_after|
+    std::mutex _lock;
+
+    std::atomic<bool> _ready{false};
+
+    //the pending computation, dropped once it has run
+    std::function<V()> _thunk;
+
+    //a suspension the computation reads, forced before it, dropped once it has run
+    Ref<LazyCell> _after;
+
+    std::optional<V> _value;
+
+    LazyCell(std::function<V()> thunk, const Ref<LazyCell>& after) : _thunk(std::move(thunk)), _after(after) {}
+
+    //Suspensions that read each other form chains of any length, they are freed from a flat worklist
+    static void release(const LazyCell* cell)
+    {
+        if (Policy::decrement(cell->_count)) release_flat(cell);
+    }
+
+    //The dependency still to be forced before this cell, null once the cell is computed
+    Ref<LazyCell> pending()
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _after;
+    }
+
+    //Runs the computation unless another caller already has
+    void evaluate()
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_ready.load(std::memory_order_relaxed)) return;
+
+        _value.emplace(_thunk());
+        _thunk = nullptr;
+        _after = nullptr;
+
+        _ready.store(true, std::memory_order_release);
+    }
+};
+
+////////////////////////////// LAZY
+
+template<typename V, typename Policy = AtomicCount>
+class Lazy
+{
+    using Cell = LazyCell<V, Policy>;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Suspends |f|, it runs the first time the result is forced
+        template <typename F>
+        static Lazy delay(F f)
+        {
+            return Lazy(make_ref<Cell>(std::function<V()>(std::move(f)), nullptr));
+        }
+
+        //Suspends |f|, which reads |dependency|
+        //Forcing the result forces |dependency| first, so |f| finds it computed
+        template <typename F>
+        static Lazy delay_after(const Lazy& dependency, F f)
+        {
+            return Lazy(make_ref<Cell>(std::function<V()>(std::move(f)), dependency.cell));
+        }
+
+        //An already evaluated suspension holding |value|
+        static Lazy of(V value)
+        {
+            Lazy lazy = delay([value = std::move(value)]() { return value; });
+            lazy.force();
+            return lazy;
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Runs the computation if it has not run yet and returns its result
+        //Pending dependencies are computed first, innermost first, in a loop rather than by
+        //nested calls, so a chain of any length is forced in constant stack
+        //Concurrent callers wait for the single evaluation
+        const V& force() const
+        {
+            if (!cell->_ready.load(std::memory_order_acquire))
+            {
+                std::vector<Ref<Cell>> chain{ cell };
+
+                while (Ref<Cell> next = chain.back()->pending()) chain.push_back(next);
+
+                for (auto pending = chain.rbegin(); pending != chain.rend(); ++pending) (*pending)->evaluate();
+            }
+
+            return *cell->_value;
+        }
+
+    private:
+
+        //////////////// DATA
+
+        Ref<Cell> cell;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        explicit Lazy(const Ref<Cell>& cell) : cell(cell) {}
+};
+
+}
+
+#endif //LAZY_HPP
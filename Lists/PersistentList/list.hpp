@@ -5,7 +5,11 @@
  */
 
 #include <iostream>
-#include <memory>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#include "ref.hpp"
 
 #ifndef LIST_HPP
 #define LIST_HPP
@@ -14,45 +18,285 @@ namespace plll {
 
 ////////////////////////////// NODE
 
-template<typename T>
-struct Node
+//The value is stored inline next to the reference count, so every node is a single allocation
+template<typename T, typename Policy = AtomicCount>
+struct Node : RefCounted<Node<T, Policy>, Policy>
 {
-    std::shared_ptr<T> _data;
-    std::shared_ptr<Node<T>> _next;
+    T _data;
+    Ref<Node<T, Policy>> _next;
 
-    explicit Node(const T& data) : _data(std::make_shared<T>(data)) {}
-    Node(const std::shared_ptr<T>& ptr) : _data(ptr) {}
+    explicit Node(const T& data) : _data(data) {}
 
-    ~Node()
+    //Frees the node once the last reference is dropped
+    //Following nodes left unreferenced are freed in the same loop instead of through
+    //nested destructors, so dropping a list of any length uses constant stack
+    static void release(const Node* node)
     {
-        _data = nullptr;
-        _next = nullptr;
+        while (node && Policy::decrement(node->_count))
+        {
+            const Node* next = const_cast<Node*>(node)->_next.detach();
+            delete node;
+            node = next;
+        }
     }
 };
 
+////////////////////////////// VALUE REFERENCE
+
+//A nullable reference to an element of a list
+//Keeps the node holding the element alive for as long as it exists
+//|N| is any counted node storing the element in |_data|
+template<typename T, typename Policy = AtomicCount, typename N = Node<T, Policy>>
+class ValueRef
+{
+    public:
+
+        ValueRef() = default;
+
+        ValueRef(std::nullptr_t) {}
+
+        explicit ValueRef(const Ref<N>& node) : node(node) {}
+
+        const T& operator*() const { return node->_data; }
+
+        const T* operator->() const { return &node->_data; }
+
+        explicit operator bool() const { return bool(node); }
+
+        bool operator==(std::nullptr_t) const { return !node; }
+
+        bool operator!=(std::nullptr_t) const { return bool(node); }
+
+        //Returns the element, or nullptr if there is none
+        const T* get() const { return node ? &node->_data : nullptr; }
+
+    private:
+
+        Ref<N> node;
+};
+
 ////////////////////////////// PERSISTENT LINEAR LINKED LIST 
 
-template<typename T>
+//Tools that walk or rebuild the shared node structure of a set of versions
+class Serializer;
+struct SharingStats;
+
+template<typename T, typename Policy, typename Hash, typename Equal>
+class Interner;
+
+//|Policy| selects how nodes are counted, see ref.hpp
+//Lists confined to a single thread can use LocalCount to avoid atomic operations
+template<typename T, typename Policy = AtomicCount>
 class List
 {
-    template <typename R>
+    template <typename R, typename P>
     friend class List;
 
+    friend class Serializer;
+    friend struct SharingStats;
+
+    template<typename R, typename P, typename H, typename E>
+    friend class Interner;
+
     public:
         
-         //////////////// MAP FUNCTION 
+        using value_type = T;
+        using policy = Policy;
+
+        //////////////// MAP, FILTER AND FOLD
+
+        //A function defined by the client will be used to operate on every item in the list
+        template <typename R>
+        List<R, Policy> map(R (*f)(const T&)) const
+        {
+            return map<R (*)(const T&)>(std::move(f));
+        }
+
+        //Any callable |f| (lambda, functor, function pointer) is applied to every item in the list
+        //The result is built in a single pass
+        template <typename F>
+        List<std::decay_t<std::invoke_result_t<F&, const T&>>, Policy> map(F f) const
+        {
+            typename List<std::decay_t<std::invoke_result_t<F&, const T&>>, Policy>::Transient builder;
+
+            for (auto current = head.get(); current; current = current->_next.get())
+                builder.push_back(f(current->_data));
+
+            return builder.persistent();
+        }
+
+        //Returns a list of the items for which |predicate| is true, in their original order
+        template <typename F>
+        List filter(F predicate) const
+        {
+            Transient builder;
+
+            for (auto current = head.get(); current; current = current->_next.get())
+                if (predicate(current->_data)) builder.push_back(current->_data);
+
+            return builder.persistent();
+        }
+
+        //Combines every item from front to back into |accumulator| with |f(accumulator, item)|
+        template <typename A, typename F>
+        A fold(A accumulator, F f) const
+        {
+            for (auto current = head.get(); current; current = current->_next.get())
+                accumulator = f(std::move(accumulator), current->_data);
+
+            return accumulator;
+        }
+
+        //////////////// ITERATION
+
+        //Read only forward iteration over the items, no reference counts are touched
+        class const_iterator
+        {
+            public:
+
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const T*;
+                using reference = const T&;
+
+                const_iterator() : node(nullptr) {}
+
+                explicit const_iterator(const Node<T, Policy>* node) : node(node) {}
+
+                reference operator*() const { return node->_data; }
+
+                pointer operator->() const { return &node->_data; }
+
+                const_iterator& operator++()
+                {
+                    node = node->_next.get();
+                    return *this;
+                }
+
+                const_iterator operator++(int)
+                {
+                    const_iterator previous = *this;
+                    node = node->_next.get();
+                    return previous;
+                }
+
+                bool operator==(const const_iterator& other) const { return node == other.node; }
+
+                bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+            private:
+
+                const Node<T, Policy>* node;
+        };
+
+        const_iterator begin() const
+        {
+            return const_iterator(head.get());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator();
+        }
+
+        //////////////// TRANSIENT BUILDER
+
+        //A batch-mutable list, nodes it holds are owned by it alone and are edited in place
+        //persistent() freezes the nodes into an immutable List in O(1) and empties the builder
+        class Transient
+        {
+            friend class List;
 
-         //A lambda function defined by the client will be used to operate on every item in the list
-         template <typename R>
-         List<R> map(R (*f)(const T&)) const
-         {
-             List<R> new_list(f(*head->_data));
+            public:
 
-             for (auto current = head->_next; current; current = current->_next)
-                new_list.grow_tail(std::make_shared<R>(f(*current->_data)));
+                //Creates an empty builder
+                Transient() : list_length(0) {}
 
-             return new_list;
-         }
+                //Returns the number of elements in the builder
+                size_t length() const
+                {
+                    return list_length;
+                }
+
+                //Appends |data| in place
+                Transient& push_back(const T& data)
+                {
+                    auto node = make_ref<Node<T, Policy>>(data);
+
+                    if (tail) tail->_next = node;
+                    else head = node;
+
+                    tail = node;
+                    ++list_length;
+
+                    return *this;
+                }
+
+                //Prepends |data| in place
+                Transient& push_front(const T& data)
+                {
+                    auto node = make_ref<Node<T, Policy>>(data);
+                    node->_next = head;
+
+                    if (!tail) tail = node;
+
+                    head = node;
+                    ++list_length;
+
+                    return *this;
+                }
+
+                //Freezes the builder's nodes into a persistent list and empties the builder
+                List persistent()
+                {
+                    List frozen;
+                    frozen.head = std::move(head);
+                    frozen.tail = std::move(tail);
+                    frozen.list_length = list_length;
+
+                    head = nullptr;
+                    tail = nullptr;
+                    list_length = 0;
+
+                    return frozen;
+                }
+
+            private:
+
+                Ref<Node<T, Policy>> head;
+                Ref<Node<T, Policy>> tail;
+                size_t list_length;
+        };
+
+        //Returns a builder holding a private copy of this list's nodes
+        Transient transient() const &
+        {
+            Transient builder;
+
+            for (auto current = head.get(); current; current = current->_next.get())
+                builder.push_back(current->_data);
+
+            return builder;
+        }
+
+        //Returns a builder over this list, the nodes are taken over without copying when
+        //no other version shares them, leaving this list empty
+        Transient transient() &&
+        {
+            if (!is_unshared()) return static_cast<const List&>(*this).transient();
+
+            Transient builder;
+            builder.head = std::move(head);
+            builder.tail = std::move(tail);
+            builder.list_length = list_length;
+
+            head = nullptr;
+            tail = nullptr;
+            list_length = 0;
+
+            return builder;
+        }
 
         //////////////// CONSTRUCTORS
 
@@ -60,11 +304,33 @@ class List
         List() : list_length(0) {}
 
         //Creates a list with a single element whose value is |data|
-        explicit List(const T& data) : head(std::make_shared<Node<T>>(data)), tail(head), list_length(1) {}
+        explicit List(const T& data) : head(make_ref<Node<T, Policy>>(data)), tail(head), list_length(1) {}
+
+        //Creates a list holding the elements of [|first|, |last|) in a single pass
+        template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+        List(It first, It last) : List(from_range(first, last)) {}
+
+        //Creates a list holding the elements of [|first|, |last|) in a single pass
+        template <typename It>
+        static List from_range(It first, It last)
+        {
+            Transient builder;
+
+            for (; first != last; ++first) builder.push_back(*first);
+
+            return builder.persistent();
+        }
+
+        //Creates a list holding the elements of |range| in a single pass
+        template <typename Range>
+        static List from_range(const Range& range)
+        {
+            return from_range(std::begin(range), std::end(range));
+        }
 
         //////////////// DESTRUCTOR 
 
-        //Sets all pointers to null, delegating memory frees to std::shared_ptr
+        //Sets all pointers to null, the last reference to a node frees it
         ~List()
         {
             head = nullptr;
@@ -85,35 +351,65 @@ class List
             return !list_length;
         }
 
+        //True if both lists are the same version, sharing every node
+        //Lists built through the same Interner are equal exactly when they are identical
+        bool identical_to(const List& other) const
+        {
+            return head == other.head && list_length == other.list_length;
+        }
+
         //Returns the first element in the list
         //Returns nullptr if the list is empty
-        std::shared_ptr<const T> first() const
+        ValueRef<T, Policy> first() const
         {
-            return head ? head->_data : nullptr;
+            return ValueRef<T, Policy>(head);
         }
 
         //Returns the last element in the list
         //Returns nullptr if the list is empty
-        std::shared_ptr<const T> last() const
+        ValueRef<T, Policy> last() const
         {
-            return tail ? tail->_data : nullptr;
+            return ValueRef<T, Policy>(tail);
         }
 
-        //Returns the nth element in the list
-        //Returns nullptr if |n| is out of bounds
-        std::shared_ptr<const T> nth(size_t n) const
+        //Returns the first element in the list without touching any reference count
+        //Throws std::out_of_range if the list is empty
+        const T& front() const
+        {
+            if (!head) throw std::out_of_range("plll::List::front on an empty list");
+
+            return head->_data;
+        }
+
+        //Returns the last element in the list without touching any reference count
+        //Throws std::out_of_range if the list is empty
+        const T& back() const
+        {
+            if (!tail) throw std::out_of_range("plll::List::back on an empty list");
+
+            return tail->_data;
+        }
+
+        //Returns the nth element in the list without touching any reference count
+        //Throws std::out_of_range if |n| is out of bounds
+        const T& at(size_t n) const
         {
-            if (is_empty() || n < 0 || n > list_length - 1) return nullptr;
+            if (n >= list_length) throw std::out_of_range("plll::List::at index out of bounds");
 
-            auto current = head;
+            return node_at(n)->_data;
+        }
 
-            for (int i = 0; i < n; ++i) current = current->_next;
+        //Returns the nth element in the list
+        //Returns nullptr if |n| is out of bounds
+        ValueRef<T, Policy> nth(size_t n) const
+        {
+            if (is_empty() || n > list_length - 1) return nullptr;
 
-            return current->_data;
+            return ValueRef<T, Policy>(Ref<Node<T, Policy>>(node_at(n)));
         }
 
         //Pushes a new element containing |data| to the back of the list
-        List<T> push_back(const T& data) const
+        List<T, Policy> push_back(const T& data) const
         {
             if (is_empty()) return List(data);
 
@@ -122,7 +418,7 @@ class List
             duplicate_nodes(new_list, head->_next, list_length - 1);
 
             //allocate and append the new node with |data|
-            new_list.grow_tail(std::make_shared<T>(data));
+            new_list.grow_tail(data);
 
             new_list.set_length(list_length + 1);
 
@@ -130,7 +426,7 @@ class List
         }
 
         //Pushes a new element containing |data| to the front of the list
-        List<T> push_front(const T& data) const
+        List<T, Policy> push_front(const T& data) const
         {
             if (is_empty()) return List(data);
 
@@ -145,9 +441,16 @@ class List
             return new_list;
         }
 
+        //Removes the first element of the list in O(1), the rest of the list is shared
+        //If the list is empty then nothing will happen
+        List<T, Policy> pop_front() const
+        {
+            return remove_at(0);
+        }
+
         //Inserts |data| at |index| location in the list
         //If index is larger than the list's size, then |data| will be pushed to the back of the list
-        List<T> insert_at(size_t index, const T& data) const
+        List<T, Policy> insert_at(size_t index, const T& data) const
         {
             //index is out of bounds
             if (index >= list_length || index < 0) return push_back(data);
@@ -160,7 +463,7 @@ class List
             auto link = duplicate_nodes(new_list, head->_next, index - 1);
 
             //insert the new node
-            new_list.grow_tail(std::make_shared<T>(data));
+            new_list.grow_tail(data);
 
             //link up the rest of the old list
             new_list.tail->_next = link;
@@ -176,7 +479,7 @@ class List
          * If the list does not have an element that corresponds
          * to |index| then nothing will happen
          */
-        List<T> remove_at(size_t index) const
+        List<T, Policy> remove_at(size_t index) const
         {
             //invalid index provided
             if (index >= list_length || index < 0 || is_empty()) return *this;
@@ -188,12 +491,9 @@ class List
             if (0 == index)
             {
 
-                //allocate head with the node after head
-                auto next = head->_next;
-                List new_list(next->_data);
-
-                //link up the rest of the list
-                new_list.head->_next = next->_next;
+                //the node after head becomes the new head, nothing is allocated
+                List new_list;
+                new_list.head = head->_next;
 
                 new_list.tail = tail;
                 new_list.set_length(list_length - 1);
@@ -222,11 +522,10 @@ class List
         {
               std::cout << name << " { " << std::endl;
 
-              for (auto current = &head; *current; current = &(*current)->_next)
+              for (auto current = head.get(); current; current = current->_next.get())
               {
-                  std::cout << "  data(" << *(*current)->_data
-                  << "), data_count(" << (*current)->_data.use_count()
-                  << "), self_count(" << (*current).use_count()
+                  std::cout << "  data(" << current->_data
+                  << "), self_count(" << current->use_count()
                   << ")," << std::endl;
               }
 
@@ -238,36 +537,50 @@ class List
         //////////////// DATA 
 
         //front of the list
-        std::shared_ptr<Node<T>> head;
+        Ref<Node<T, Policy>> head;
 
         //end of the list
-        std::shared_ptr<Node<T>> tail;
+        Ref<Node<T, Policy>> tail;
 
         //the number of nodes currently in the list
         size_t list_length;
 
         //////////////// PRIVATE FUNCTIONS 
 
-        //Makes a new list with a single node at the value |data|.
-        explicit List(std::shared_ptr<T>& data) : head(std::make_shared<Node<T>>(data)), tail(head), list_length(1) {}
-
-        //Allocate a new node with |data| at the end of the list.
-        void grow_tail(std::shared_ptr<T> data) 
+        //Allocate a new node with a copy of |data| at the end of the list.
+        void grow_tail(const T& data)
         {
-            tail->_next = std::make_shared<Node<T>>(data);
+            tail->_next = make_ref<Node<T, Policy>>(data);
             tail = tail->_next;
         }
 
+        //True if no other version can reach this list's nodes
+        //Every version sharing a node also ends at the same tail node, so it is enough
+        //that the tail is only referenced by this list and the node before it
+        bool is_unshared() const
+        {
+            return !tail || tail->use_count() == 2;
+        }
+
+        //Walk |n| nodes from the head without touching any reference count
+        Node<T, Policy>* node_at(size_t n) const
+        {
+            auto current = head.get();
+
+            for (size_t i = 0; i < n; ++i) current = current->_next.get();
+
+            return current;
+        }
+
         //Assign |list_length| a new specified value
         void set_length(const size_t length) { list_length = length; }
 
         //Make a copy of the nodes from |source| in the current list up to |index|.
-        //The nodes will still share the underlying data's memory.
         //If the index is out of bounds, the entire list will be duplicated.
         //Return the node that follows all duplications, which could be null.
-        static std::shared_ptr<Node<T>> duplicate_nodes(List& new_list, std::shared_ptr<Node<T>> source, const size_t index)
+        static Ref<Node<T, Policy>> duplicate_nodes(List& new_list, Ref<Node<T, Policy>> source, const size_t index)
         {
-            for (int i = 0; i < index; ++i)
+            for (size_t i = 0; i < index; ++i)
             {
                 new_list.grow_tail(source->_data);
                 source = source->_next;
@@ -0,0 +1,25 @@
+/* @author, Sean Siders, sean.siders@icloud.com */
+
+#include "atomic.hpp"
+#include "catenable.hpp"
+#include "fingertree.hpp"
+#include "hamt.hpp"
+#include "intern.hpp"
+#include "list.hpp"
+#include "queue.hpp"
+#include "ralist.hpp"
+#include "reclaimer.hpp"
+#include "serialize.hpp"
+#include "stats.hpp"
+#include "stream.hpp"
+#include "vector.hpp"
+#include "view.hpp"
+#include "zipper.hpp"
+#include "unit_tests.hpp"
+
+int main()
+{
+    PersistentTests persistent_tests;
+
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Persistent real-time FIFO queue (Hood-Melville, as presented by Okasaki).
+ *
+ * Elements are popped from |head| and pushed onto the reversed |rear|, both
+ * plain plll::Lists. Once |rear| grows longer than |head| the two are rotated
+ * into a new front, but the rotation is carried out incrementally, a few steps
+ * during every push_back and pop_front. No single operation ever pays for a
+ * whole reversal, so push_back, pop_front and first are O(1) in the worst case,
+ * even when many old versions of the queue are still being used.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <stdexcept>
+
+#include "list.hpp"
+
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+
+namespace plll {
+
+////////////////////////////// PERSISTENT QUEUE
+
+template<typename T, typename Policy = AtomicCount>
+class Queue
+{
+    using Seq = List<T, Policy>;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty queue
+        Queue() : head_length(0), rear_length(0) {}
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of elements in the queue
+        size_t length() const
+        {
+            return head_length + rear_length;
+        }
+
+        //True if the queue is empty, otherwise false
+        bool is_empty() const
+        {
+            return !head_length;
+        }
+
+        //Returns the oldest element in the queue
+        //Returns nullptr if the queue is empty
+        ValueRef<T, Policy> first() const
+        {
+            return head.first();
+        }
+
+        //Returns the oldest element in the queue without touching any reference count
+        //Throws std::out_of_range if the queue is empty
+        const T& front() const
+        {
+            if (is_empty()) throw std::out_of_range("plll::Queue::front on an empty queue");
+
+            return head.front();
+        }
+
+        //Pushes a new element containing |data| to the back of the queue
+        Queue push_back(const T& data) const
+        {
+            Queue new_queue(*this);
+            new_queue.rear = rear.push_front(data);
+            ++new_queue.rear_length;
+
+            return new_queue.check();
+        }
+
+        //Removes the oldest element of the queue
+        //If the queue is empty then nothing will happen
+        Queue pop_front() const
+        {
+            if (is_empty()) return *this;
+
+            Queue new_queue(*this);
+            new_queue.head = head.pop_front();
+            --new_queue.head_length;
+            new_queue.rotation = rotation.invalidate();
+
+            return new_queue.check();
+        }
+
+    private:
+
+        //////////////// ROTATION
+
+        //The state of an incremental rotation of |front| ++ reverse(|rear|)
+        //Reversing : |front| is reversed into |front_reversed| while |rear| is reversed into |result|
+        //Appending : |front_reversed| is pushed back onto |result|, |valid| elements are still needed
+        //Done      : |result| is the new head
+        struct Rotation
+        {
+            enum Phase { IDLE, REVERSING, APPENDING, DONE };
+
+            Phase phase = IDLE;
+
+            //the number of copied front elements that have not been popped since
+            size_t valid = 0;
+
+            Seq front;
+            Seq front_reversed;
+            Seq rear;
+            Seq result;
+
+            //Perform one step of the rotation
+            Rotation step() const
+            {
+                Rotation next(*this);
+
+                if (phase == REVERSING)
+                {
+                    //the last rear element completes the reversal
+                    if (front.is_empty())
+                    {
+                        next.phase = APPENDING;
+                        next.result = result.push_front(rear.front());
+                        next.rear = Seq();
+                        return next;
+                    }
+
+                    ++next.valid;
+                    next.front = front.pop_front();
+                    next.front_reversed = front_reversed.push_front(front.front());
+                    next.rear = rear.pop_front();
+                    next.result = result.push_front(rear.front());
+                }
+
+                else if (phase == APPENDING)
+                {
+                    if (!valid)
+                    {
+                        next.phase = DONE;
+                        next.front_reversed = Seq();
+                        return next;
+                    }
+
+                    --next.valid;
+                    next.front_reversed = front_reversed.pop_front();
+                    next.result = result.push_front(front_reversed.front());
+                }
+
+                return next;
+            }
+
+            //Account for an element popped from the front while the rotation is running
+            Rotation invalidate() const
+            {
+                Rotation next(*this);
+
+                if (phase == REVERSING) --next.valid;
+
+                else if (phase == APPENDING)
+                {
+                    //the popped element was the only one still to be appended
+                    if (!valid)
+                    {
+                        next.phase = DONE;
+                        next.front_reversed = Seq();
+                        next.result = result.pop_front();
+                    }
+
+                    else --next.valid;
+                }
+
+                return next;
+            }
+        };
+
+        //////////////// DATA
+
+        //the elements to be popped next, oldest first
+        Seq head;
+        size_t head_length;
+
+        //the rotation in progress, if any
+        Rotation rotation;
+
+        //the most recently pushed elements, newest first
+        Seq rear;
+        size_t rear_length;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        //Advance the rotation two steps, installing the new head once it is done
+        Queue& advance()
+        {
+            rotation = rotation.step().step();
+
+            if (rotation.phase == Rotation::DONE)
+            {
+                head = rotation.result;
+                rotation = Rotation();
+            }
+
+            return *this;
+        }
+
+        //Start a rotation as soon as the rear grows longer than the head
+        Queue& check()
+        {
+            if (rear_length > head_length)
+            {
+                rotation = Rotation();
+                rotation.phase = Rotation::REVERSING;
+                rotation.front = head;
+                rotation.rear = rear;
+
+                head_length += rear_length;
+                rear = Seq();
+                rear_length = 0;
+            }
+
+            return advance();
+        }
+};
+
+}
+
+#endif //QUEUE_HPP
@@ -0,0 +1,243 @@
+/*
+ * Persistent skew-binary random-access list (Okasaki).
+ * The list is a spine of complete binary trees whose sizes are skew-binary
+ * numbers (2^k - 1), at most the first two being equal. This keeps push_front,
+ * first and pop_front O(1) like plll::List, while nth and update only descend
+ * one tree of O(log N) depth after skipping O(log N) trees on the spine.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <stdexcept>
+
+#include "list.hpp"
+
+#ifndef RALIST_HPP
+#define RALIST_HPP
+
+namespace plll {
+
+////////////////////////////// TREE NODE
+
+//A node of one of the complete binary trees, the element is stored in pre-order
+template<typename T, typename Policy = AtomicCount>
+struct TreeNode : RefCounted<TreeNode<T, Policy>, Policy>
+{
+    T _data;
+    Ref<TreeNode<T, Policy>> _left;
+    Ref<TreeNode<T, Policy>> _right;
+
+    explicit TreeNode(const T& data) : _data(data) {}
+
+    TreeNode(const T& data, const Ref<TreeNode<T, Policy>>& left, const Ref<TreeNode<T, Policy>>& right)
+        : _data(data), _left(left), _right(right) {}
+};
+
+////////////////////////////// SPINE NODE
+
+//A link of the spine holding one complete tree of |_size| elements
+template<typename T, typename Policy = AtomicCount>
+struct SpineNode : RefCounted<SpineNode<T, Policy>, Policy>
+{
+    size_t _size;
+    Ref<TreeNode<T, Policy>> _tree;
+    Ref<SpineNode<T, Policy>> _next;
+
+    SpineNode(size_t size, const Ref<TreeNode<T, Policy>>& tree, const Ref<SpineNode<T, Policy>>& next)
+        : _size(size), _tree(tree), _next(next) {}
+};
+
+////////////////////////////// PERSISTENT RANDOM ACCESS LIST
+
+template<typename T, typename Policy = AtomicCount>
+class RandomAccessList
+{
+    using Tree = TreeNode<T, Policy>;
+    using Spine = SpineNode<T, Policy>;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty list
+        RandomAccessList() : list_length(0) {}
+
+        //Creates a list with a single element whose value is |data|
+        explicit RandomAccessList(const T& data) : RandomAccessList(RandomAccessList().push_front(data)) {}
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of elements in the list
+        size_t length() const
+        {
+            return list_length;
+        }
+
+        //True if the list is empty, otherwise false
+        bool is_empty() const
+        {
+            return !list_length;
+        }
+
+        //Returns the first element in the list
+        //Returns nullptr if the list is empty
+        ValueRef<T, Policy, Tree> first() const
+        {
+            return spine ? ValueRef<T, Policy, Tree>(spine->_tree) : nullptr;
+        }
+
+        //Returns the nth element in the list
+        //Returns nullptr if |n| is out of bounds
+        ValueRef<T, Policy, Tree> nth(size_t n) const
+        {
+            if (n >= list_length) return nullptr;
+
+            return ValueRef<T, Policy, Tree>(Ref<Tree>(node_at(n)));
+        }
+
+        //Returns the first element in the list without touching any reference count
+        //Throws std::out_of_range if the list is empty
+        const T& front() const
+        {
+            if (!spine) throw std::out_of_range("plll::RandomAccessList::front on an empty list");
+
+            return spine->_tree->_data;
+        }
+
+        //Returns the nth element in the list without touching any reference count
+        //Throws std::out_of_range if |n| is out of bounds
+        const T& at(size_t n) const
+        {
+            if (n >= list_length) throw std::out_of_range("plll::RandomAccessList::at index out of bounds");
+
+            return node_at(n)->_data;
+        }
+
+        //Pushes a new element containing |data| to the front of the list
+        RandomAccessList push_front(const T& data) const
+        {
+            RandomAccessList new_list;
+            new_list.list_length = list_length + 1;
+
+            //the first two trees are the same size, merge them under the new element
+            if (spine && spine->_next && spine->_size == spine->_next->_size)
+            {
+                auto second = spine->_next;
+                auto tree = make_ref<Tree>(data, spine->_tree, second->_tree);
+                new_list.spine = make_ref<Spine>(1 + 2 * spine->_size, tree, second->_next);
+            }
+
+            else new_list.spine = make_ref<Spine>(1, make_ref<Tree>(data), spine);
+
+            return new_list;
+        }
+
+        //Removes the first element of the list
+        //If the list is empty then nothing will happen
+        RandomAccessList pop_front() const
+        {
+            if (is_empty()) return *this;
+
+            RandomAccessList new_list;
+            new_list.list_length = list_length - 1;
+
+            //a single element tree is dropped from the spine
+            if (spine->_size == 1) new_list.spine = spine->_next;
+
+            //otherwise the root is dropped and both halves go back on the spine
+            else
+            {
+                size_t half = spine->_size / 2;
+                auto right = make_ref<Spine>(half, spine->_tree->_right, spine->_next);
+                new_list.spine = make_ref<Spine>(half, spine->_tree->_left, right);
+            }
+
+            return new_list;
+        }
+
+        //Replaces the element at |index| with |data|
+        //If |index| is out of bounds then nothing will happen
+        RandomAccessList update(size_t index, const T& data) const
+        {
+            if (index >= list_length) return *this;
+
+            RandomAccessList new_list;
+            new_list.list_length = list_length;
+            new_list.spine = update(spine, index, data);
+
+            return new_list;
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //the trees of the list, smallest first
+        Ref<Spine> spine;
+
+        //the number of elements currently in the list
+        size_t list_length;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        //Find the tree node holding the element at |n|, which must be in bounds
+        Tree* node_at(size_t n) const
+        {
+            auto link = spine.get();
+
+            //skip the trees that end before |n|
+            while (n >= link->_size)
+            {
+                n -= link->_size;
+                link = link->_next.get();
+            }
+
+            auto node = link->_tree.get();
+
+            //descend the tree, |size| is the size of the subtree rooted at |node|
+            for (size_t size = link->_size; n; size /= 2)
+            {
+                size_t half = size / 2;
+
+                if (n <= half)
+                {
+                    node = node->_left.get();
+                    n -= 1;
+                }
+
+                else
+                {
+                    node = node->_right.get();
+                    n -= 1 + half;
+                }
+            }
+
+            return node;
+        }
+
+        //Copy the spine up to the tree holding |index| and that tree's path to it
+        static Ref<Spine> update(const Ref<Spine>& link, size_t index, const T& data)
+        {
+            if (index >= link->_size)
+                return make_ref<Spine>(link->_size, link->_tree, update(link->_next, index - link->_size, data));
+
+            return make_ref<Spine>(link->_size, update(link->_tree, link->_size, index, data), link->_next);
+        }
+
+        //Copy the path from |node| to the element at |index| with that element replaced by |data|
+        static Ref<Tree> update(const Ref<Tree>& node, size_t size, size_t index, const T& data)
+        {
+            if (index == 0) return make_ref<Tree>(data, node->_left, node->_right);
+
+            size_t half = size / 2;
+
+            if (index <= half)
+                return make_ref<Tree>(node->_data, update(node->_left, half, index - 1, data), node->_right);
+
+            return make_ref<Tree>(node->_data, node->_left, update(node->_right, half, index - 1 - half, data));
+        }
+};
+
+}
+
+#endif //RALIST_HPP
@@ -0,0 +1,125 @@
+/*
+ * Background reclamation of dropped versions.
+ * Releasing the last reference to a long list frees every node it owns, which
+ * takes time proportional to its length. Handing the version to a Reclaimer
+ * moves that work onto a worker thread, so the caller only pays for a queue push.
+ *
+ * Only structures counted with AtomicCount may be retired, the worker thread
+ * drops their references concurrently with the threads still sharing nodes.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef RECLAIMER_HPP
+#define RECLAIMER_HPP
+
+namespace plll {
+
+////////////////////////////// RECLAIMER
+
+class Reclaimer
+{
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Starts the worker thread
+        Reclaimer() : stopping(false), worker([this] { run(); }) {}
+
+        Reclaimer(const Reclaimer&) = delete;
+        Reclaimer& operator=(const Reclaimer&) = delete;
+
+        //////////////// DESTRUCTOR
+
+        //Frees everything still queued, then stops the worker thread
+        ~Reclaimer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            wake.notify_one();
+            worker.join();
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Takes over |version|, it will be dropped on the worker thread
+        template <typename V>
+        void retire(V&& version)
+        {
+            auto garbage = std::make_unique<Holder<std::decay_t<V>>>(std::forward<V>(version));
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(std::move(garbage));
+            }
+
+            wake.notify_one();
+        }
+
+    private:
+
+        //////////////// GARBAGE
+
+        struct Garbage
+        {
+            virtual ~Garbage() {}
+        };
+
+        template <typename V>
+        struct Holder : Garbage
+        {
+            V version;
+
+            explicit Holder(V&& version) : version(std::move(version)) {}
+            explicit Holder(const V& version) : version(version) {}
+        };
+
+        //////////////// DATA
+
+        std::mutex mutex;
+        std::condition_variable wake;
+
+        //versions waiting to be dropped
+        std::vector<std::unique_ptr<Garbage>> pending;
+
+        //set once the destructor runs
+        bool stopping;
+
+        std::thread worker;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        //Drops queued versions in batches, outside of the lock
+        void run()
+        {
+            std::vector<std::unique_ptr<Garbage>> batch;
+
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this] { return stopping || !pending.empty(); });
+
+                    if (pending.empty()) return;
+
+                    batch.swap(pending);
+                }
+
+                batch.clear();
+            }
+        }
+};
+
+}
+
+#endif //RECLAIMER_HPP
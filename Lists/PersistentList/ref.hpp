@@ -0,0 +1,220 @@
+/*
+ * Intrusive reference counting shared by the persistent structures.
+ * The count lives inside the node itself, so a node is a single allocation
+ * and sharing it costs one counter update instead of a separate control block.
+ *
+ * The counting policy is chosen per structure:
+ *   AtomicCount : versions may be shared between threads (default)
+ *   LocalCount  : versions never leave the thread that created them, counts are plain integers
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#ifndef REF_HPP
+#define REF_HPP
+
+namespace plll {
+
+////////////////////////////// COUNTING POLICIES
+
+//Thread safe counting, every update is a locked atomic operation
+struct AtomicCount
+{
+    using counter = std::atomic<size_t>;
+
+    static void increment(counter& count)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //True if the last reference was dropped
+    static bool decrement(counter& count)
+    {
+        return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    static size_t load(const counter& count)
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+//Single threaded counting, nodes must never be shared across threads
+struct LocalCount
+{
+    using counter = size_t;
+
+    static void increment(counter& count)
+    {
+        ++count;
+    }
+
+    //True if the last reference was dropped
+    static bool decrement(counter& count)
+    {
+        return --count == 0;
+    }
+
+    static size_t load(const counter& count)
+    {
+        return count;
+    }
+};
+
+////////////////////////////// REFERENCE COUNTED BASE
+
+//Nodes derive from this to embed their reference count
+//|Derived| may hide release() to customize how the last reference frees it
+template<typename Derived, typename Policy = AtomicCount>
+struct RefCounted
+{
+    using policy = Policy;
+
+    mutable typename Policy::counter _count{0};
+
+    //The number of references currently held to this node
+    size_t use_count() const
+    {
+        return Policy::load(_count);
+    }
+
+    static void retain(const Derived* node)
+    {
+        Policy::increment(node->_count);
+    }
+
+    static void release(const Derived* node)
+    {
+        if (Policy::decrement(node->_count)) delete node;
+    }
+};
+
+////////////////////////////// FLAT RELEASE
+
+//Deletes |node|, whose count already dropped to zero, without nesting destructors
+//Nodes of the same type freed by its destructor are queued on a worklist and deleted
+//by the outermost call, so releasing deep or long structures uses constant stack
+template<typename N>
+void release_flat(const N* node)
+{
+    thread_local std::vector<const N*>* pending = nullptr;
+
+    //already inside a release on this thread, let it free the node
+    if (pending)
+    {
+        pending->push_back(node);
+        return;
+    }
+
+    std::vector<const N*> worklist{ node };
+    pending = &worklist;
+
+    while (!worklist.empty())
+    {
+        const N* next = worklist.back();
+        worklist.pop_back();
+        delete next;
+    }
+
+    pending = nullptr;
+}
+
+////////////////////////////// INTRUSIVE REFERENCE
+
+template<typename N>
+class Ref
+{
+    template<typename M>
+    friend class Ref;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        Ref() : node(nullptr) {}
+
+        Ref(std::nullptr_t) : node(nullptr) {}
+
+        //Takes a new reference to |ptr|
+        explicit Ref(N* ptr) : node(ptr)
+        {
+            if (node) N::retain(node);
+        }
+
+        Ref(const Ref& other) : Ref(other.node) {}
+
+        Ref(Ref&& other) noexcept : node(other.node)
+        {
+            other.node = nullptr;
+        }
+
+        //////////////// DESTRUCTOR
+
+        ~Ref()
+        {
+            if (node) N::release(node);
+        }
+
+        //////////////// OPERATORS
+
+        Ref& operator=(Ref other) noexcept
+        {
+            std::swap(node, other.node);
+            return *this;
+        }
+
+        N& operator*() const { return *node; }
+
+        N* operator->() const { return node; }
+
+        explicit operator bool() const { return node != nullptr; }
+
+        bool operator==(const Ref& other) const { return node == other.node; }
+
+        bool operator!=(const Ref& other) const { return node != other.node; }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        N* get() const
+        {
+            return node;
+        }
+
+        //Gives up ownership of the node without releasing it
+        N* detach()
+        {
+            N* ptr = node;
+            node = nullptr;
+            return ptr;
+        }
+
+        //Wraps |ptr| without taking a new reference
+        static Ref adopt(N* ptr)
+        {
+            Ref ref;
+            ref.node = ptr;
+            return ref;
+        }
+
+    private:
+
+        //////////////// DATA
+
+        N* node;
+};
+
+//Allocates a node and returns the first reference to it
+template<typename N, typename... Args>
+Ref<N> make_ref(Args&&... args)
+{
+    return Ref<N>(new N(std::forward<Args>(args)...));
+}
+
+}
+
+#endif //REF_HPP
@@ -0,0 +1,429 @@
+/*
+ * Sharing-preserving serialization of sets of plll::List versions.
+ *
+ * Versions that share a suffix point at the same nodes in memory, so the file
+ * stores the union of their nodes as a DAG: every node is written once and its
+ * successor is referenced by index. Nodes are numbered so that a successor is
+ * always written before its predecessors, which lets the loader rebuild the
+ * shared structure in a single forward pass.
+ *
+ * FILE LAYOUT (native byte order)
+ *
+ *   header   : magic "PLLL", format version, node count, version count, element size
+ *   nodes    : one record per node, the element bytes padded to 8, then the 1-based
+ *              index of the next node (0 for none)
+ *   versions : 1-based index of the head node, of the tail node, and the length
+ *
+ * Elements are written as raw bytes, so T must be trivially copyable, and are
+ * copied back out of them without default constructing a T. Loading checks
+ * that every node refers to an earlier one and that every version's tail and
+ * length match the chain of nodes from its head.
+ *
+ * MappedVersions reads a file in place through a read-only mmap, without
+ * allocating any nodes.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "list.hpp"
+
+#ifndef SERIALIZE_HPP
+#define SERIALIZE_HPP
+
+namespace plll {
+
+////////////////////////////// FILE HEADER
+
+struct SerializedHeader
+{
+    char magic[4];
+    uint32_t format;
+    uint64_t node_count;
+    uint64_t version_count;
+    uint64_t element_size;
+};
+
+constexpr uint32_t SERIALIZED_FORMAT = 1;
+
+//Size of a node record holding an element of type |T|
+template <typename T>
+constexpr uint64_t record_size()
+{
+    return (sizeof(T) + 7) / 8 * 8 + sizeof(uint64_t);
+}
+
+//Copies the element stored at |bytes| out of the file
+//T is trivially copyable, so its bytes form a T without T having to be default constructible
+template <typename T>
+T decode(const char* bytes)
+{
+    alignas(T) unsigned char storage[sizeof(T)];
+    std::memcpy(storage, bytes, sizeof(T));
+
+    return *std::launder(reinterpret_cast<const T*>(storage));
+}
+
+////////////////////////////// CHAIN CHECK
+
+//The length and last node of the chain starting at each node, filled in the loader's forward pass
+//Every successor is an earlier node, so both are known as soon as a node is added
+class SerializedChains
+{
+    public:
+
+        //Adds the next node, whose successor has the 1-based index |next| (0 for none)
+        //Throws std::runtime_error unless |next| is an earlier node
+        void add(uint64_t next)
+        {
+            if (next > lengths.size()) throw std::runtime_error("plll::Serializer bad node reference");
+
+            lengths.push_back(next ? lengths[next - 1] + 1 : 1);
+            lasts.push_back(next ? lasts[next - 1] : lengths.size());
+        }
+
+        //Throws std::runtime_error unless the version entry |head|, |tail|, |length| describes
+        //the chain of nodes from |head|
+        void check(uint64_t head, uint64_t tail, uint64_t length) const
+        {
+            bool valid = head ? head <= lengths.size() && tail == lasts[head - 1] && length == lengths[head - 1]
+                              : !tail && !length;
+
+            if (!valid) throw std::runtime_error("plll::Serializer bad version entry");
+        }
+
+    private:
+
+        std::vector<uint64_t> lengths;
+        std::vector<uint64_t> lasts;
+};
+
+////////////////////////////// SERIALIZER
+
+class Serializer
+{
+    public:
+
+        //Writes |versions| to |out|, every node shared between them is written once
+        template <typename T, typename Policy>
+        static void write(std::ostream& out, const std::vector<List<T, Policy>>& versions)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "serialized elements must be trivially copyable");
+
+            using NodeT = Node<T, Policy>;
+
+            //1-based index of every node seen so far
+            std::unordered_map<const NodeT*, uint64_t> index;
+            std::vector<const NodeT*> order;
+            std::vector<const NodeT*> path;
+
+            //number the nodes of each version from its end, stopping at the first node already numbered
+            for (const auto& version : versions)
+            {
+                path.clear();
+
+                for (auto current = version.head.get(); current && !index.count(current); current = current->_next.get())
+                    path.push_back(current);
+
+                for (size_t i = path.size(); i > 0; --i)
+                {
+                    order.push_back(path[i - 1]);
+                    index.emplace(path[i - 1], order.size());
+                }
+            }
+
+            SerializedHeader header{ { 'P', 'L', 'L', 'L' }, SERIALIZED_FORMAT, order.size(), versions.size(), sizeof(T) };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            char record[record_size<T>()];
+
+            for (const NodeT* node : order)
+            {
+                std::memset(record, 0, sizeof(record));
+                std::memcpy(record, &node->_data, sizeof(T));
+
+                uint64_t next = node->_next ? index[node->_next.get()] : 0;
+                std::memcpy(record + sizeof(record) - sizeof(uint64_t), &next, sizeof(uint64_t));
+
+                out.write(record, sizeof(record));
+            }
+
+            for (const auto& version : versions)
+            {
+                uint64_t entry[3] = {
+                    version.head ? index[version.head.get()] : 0,
+                    version.tail ? index[version.tail.get()] : 0,
+                    version.list_length
+                };
+
+                out.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+            }
+
+            if (!out) throw std::runtime_error("plll::Serializer::write failed");
+        }
+
+        //Reads versions written by write(), nodes shared in the file are shared again in memory
+        template <typename T, typename Policy = AtomicCount>
+        static std::vector<List<T, Policy>> read(std::istream& in)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "serialized elements must be trivially copyable");
+
+            using NodeRef = Ref<Node<T, Policy>>;
+
+            SerializedHeader header;
+            in.read(reinterpret_cast<char*>(&header), sizeof(header));
+            check(bool(in), header, sizeof(T));
+
+            //Counts come from the stream, so vectors grow with what is actually read instead of reserving them
+            std::vector<NodeRef> nodes;
+
+            SerializedChains chains;
+
+            char record[record_size<T>()];
+
+            for (uint64_t i = 0; i < header.node_count; ++i)
+            {
+                if (!in.read(record, sizeof(record))) throw std::runtime_error("plll::Serializer::read truncated node");
+
+                uint64_t next;
+                std::memcpy(&next, record + sizeof(record) - sizeof(uint64_t), sizeof(uint64_t));
+
+                chains.add(next);
+
+                nodes.push_back(make_ref<Node<T, Policy>>(decode<T>(record)));
+                if (next) nodes.back()->_next = nodes[next - 1];
+            }
+
+            std::vector<List<T, Policy>> versions;
+
+            for (uint64_t i = 0; i < header.version_count; ++i)
+            {
+                uint64_t entry[3];
+
+                if (!in.read(reinterpret_cast<char*>(entry), sizeof(entry))) throw std::runtime_error("plll::Serializer::read truncated version");
+
+                chains.check(entry[0], entry[1], entry[2]);
+
+                List<T, Policy> version;
+                if (entry[0]) version.head = nodes[entry[0] - 1];
+                if (entry[1]) version.tail = nodes[entry[1] - 1];
+                version.list_length = entry[2];
+
+                versions.push_back(version);
+            }
+
+            return versions;
+        }
+
+        //Throws unless |header| describes a file of |T| elements
+        static void check(bool ok, const SerializedHeader& header, uint64_t element_size)
+        {
+            if (!ok || std::memcmp(header.magic, "PLLL", 4) != 0) throw std::runtime_error("plll::Serializer not a serialized list file");
+            if (header.format != SERIALIZED_FORMAT) throw std::runtime_error("plll::Serializer unsupported format");
+            if (header.element_size != element_size) throw std::runtime_error("plll::Serializer element size mismatch");
+        }
+};
+
+////////////////////////////// MAPPED VERSIONS
+
+//A read-only view of a serialized file mapped into memory
+//Elements are read in place, nothing is allocated per node
+//The constructor validates the file like Serializer::read, in one pass whose bookkeeping is
+//dropped once it returns
+template <typename T>
+class MappedVersions
+{
+    static_assert(std::is_trivially_copyable<T>::value, "serialized elements must be trivially copyable");
+
+    public:
+
+        //////////////// ITERATOR
+
+        //Walks one version, yielding elements by value
+        class const_iterator
+        {
+            public:
+
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const T*;
+                using reference = T;
+
+                const_iterator() : view(nullptr), node(0) {}
+
+                const_iterator(const MappedVersions* view, uint64_t node) : view(view), node(node) {}
+
+                T operator*() const
+                {
+                    return decode<T>(view->record(node));
+                }
+
+                const_iterator& operator++()
+                {
+                    node = view->next(node);
+                    return *this;
+                }
+
+                const_iterator operator++(int)
+                {
+                    const_iterator previous = *this;
+                    ++*this;
+                    return previous;
+                }
+
+                bool operator==(const const_iterator& other) const { return node == other.node; }
+
+                bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+            private:
+
+                const MappedVersions* view;
+
+                //1-based node index, 0 past the end
+                uint64_t node;
+        };
+
+        //////////////// CONSTRUCTORS
+
+        //Maps the file at |path|
+        //Throws std::runtime_error if it cannot be mapped or is not a file of |T| elements
+        explicit MappedVersions(const std::string& path) : base(nullptr), size(0)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("plll::MappedVersions cannot open " + path);
+
+            struct stat info;
+
+            if (::fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(SerializedHeader))
+            {
+                ::close(fd);
+                throw std::runtime_error("plll::MappedVersions cannot read " + path);
+            }
+
+            size = info.st_size;
+            void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+
+            if (mapped == MAP_FAILED) throw std::runtime_error("plll::MappedVersions cannot map " + path);
+
+            base = static_cast<const char*>(mapped);
+            std::memcpy(&header, base, sizeof(header));
+
+            try
+            {
+                Serializer::check(true, header, sizeof(T));
+
+                //Bound each count by the bytes left before multiplying, so a forged header cannot wrap the offsets
+                if (header.node_count > (size - sizeof(SerializedHeader)) / record_size<T>() ||
+                    header.version_count > (size - versions_offset()) / (3 * sizeof(uint64_t)))
+                    throw std::runtime_error("plll::MappedVersions truncated file " + path);
+
+                SerializedChains chains;
+
+                for (uint64_t node = 1; node <= header.node_count; ++node) chains.add(next(node));
+                for (size_t v = 0; v < count(); ++v) chains.check(entry(v, 0), entry(v, 1), entry(v, 2));
+            }
+
+            catch (...)
+            {
+                ::munmap(const_cast<char*>(base), size);
+                throw;
+            }
+        }
+
+        MappedVersions(const MappedVersions&) = delete;
+        MappedVersions& operator=(const MappedVersions&) = delete;
+
+        //////////////// DESTRUCTOR
+
+        ~MappedVersions()
+        {
+            ::munmap(const_cast<char*>(base), size);
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //The number of versions in the file
+        size_t count() const
+        {
+            return header.version_count;
+        }
+
+        //The number of unique nodes in the file
+        size_t node_count() const
+        {
+            return header.node_count;
+        }
+
+        //The number of elements in version |v|
+        size_t length(size_t v) const
+        {
+            return entry(v, 2);
+        }
+
+        const_iterator begin(size_t v) const
+        {
+            return const_iterator(this, entry(v, 0));
+        }
+
+        const_iterator end(size_t) const
+        {
+            return const_iterator();
+        }
+
+    private:
+
+        //////////////// DATA
+
+        const char* base;
+        size_t size;
+        SerializedHeader header;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        size_t versions_offset() const
+        {
+            return sizeof(SerializedHeader) + header.node_count * record_size<T>();
+        }
+
+        const char* record(uint64_t node) const
+        {
+            return base + sizeof(SerializedHeader) + (node - 1) * record_size<T>();
+        }
+
+        uint64_t next(uint64_t node) const
+        {
+            uint64_t next;
+            std::memcpy(&next, record(node) + record_size<T>() - sizeof(uint64_t), sizeof(uint64_t));
+            return next;
+        }
+
+        //Field |field| of the entry of version |v|
+        uint64_t entry(size_t v, size_t field) const
+        {
+            uint64_t value;
+            std::memcpy(&value, base + versions_offset() + (v * 3 + field) * sizeof(uint64_t), sizeof(uint64_t));
+            return value;
+        }
+};
+
+}
+
+#endif //SERIALIZE_HPP
@@ -0,0 +1,112 @@
+/*
+ * Structural sharing and memory accounting for sets of plll::List versions.
+ * Measuring walks every node reachable from the versions once, so the cost is
+ * proportional to the memory actually held rather than to the sum of lengths.
+ *
+ *   auto stats = plll::SharingStats::measure(versions);
+ *   double saved = stats.sharing_ratio();
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+
+#include "list.hpp"
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+namespace plll {
+
+////////////////////////////// SHARING STATISTICS
+
+struct SharingStats
+{
+    //the number of versions measured
+    size_t versions = 0;
+
+    //the sum of the versions' lengths, the node count if nothing were shared
+    size_t logical_nodes = 0;
+
+    //the number of distinct nodes reachable from the versions
+    size_t unique_nodes = 0;
+
+    //distinct nodes reachable from more than one version
+    size_t shared_nodes = 0;
+
+    //distinct nodes reachable from exactly one version
+    size_t exclusive_nodes = 0;
+
+    //memory held by the distinct nodes
+    size_t bytes = 0;
+
+    //the sum of the reference counts of the distinct nodes
+    size_t total_refcount = 0;
+
+    //Mean reference count of a distinct node
+    double average_refcount() const
+    {
+        return unique_nodes ? double(total_refcount) / unique_nodes : 0;
+    }
+
+    //Fraction of the logical nodes that sharing avoided allocating
+    double sharing_ratio() const
+    {
+        return logical_nodes ? 1 - double(unique_nodes) / logical_nodes : 0;
+    }
+
+    //Fraction of the distinct nodes that are reachable from more than one version
+    double shared_fraction() const
+    {
+        return unique_nodes ? double(shared_nodes) / unique_nodes : 0;
+    }
+
+    //Measures every version in |versions|, any range of plll::List
+    template <typename Range>
+    static SharingStats measure(const Range& versions)
+    {
+        using ListT = typename std::decay<decltype(*std::begin(versions))>::type;
+        using NodeT = Node<typename ListT::value_type, typename ListT::policy>;
+
+        SharingStats stats;
+
+        //true once a node is known to be reachable from more than one version
+        std::unordered_map<const NodeT*, bool> seen;
+
+        for (const ListT& version : versions)
+        {
+            ++stats.versions;
+            stats.logical_nodes += version.list_length;
+
+            auto current = version.head.get();
+
+            for (; current && !seen.count(current); current = current->_next.get())
+            {
+                seen.emplace(current, false);
+                stats.total_refcount += current->use_count();
+            }
+
+            //the rest of this version was already reached, mark it shared until a node already marked
+            for (; current; current = current->_next.get())
+            {
+                bool& shared = seen[current];
+                if (shared) break;
+
+                shared = true;
+                ++stats.shared_nodes;
+            }
+        }
+
+        stats.unique_nodes = seen.size();
+        stats.exclusive_nodes = stats.unique_nodes - stats.shared_nodes;
+        stats.bytes = stats.unique_nodes * sizeof(NodeT);
+
+        return stats;
+    }
+};
+
+}
+
+#endif //STATS_HPP
@@ -0,0 +1,238 @@
+/*
+ * Lazy persistent streams.
+ *
+ * A stream is a memoized suspension of its first cell, and every cell holds an
+ * element and the stream of the elements after it. Nothing is computed until
+ * it is read, and whatever is computed is kept in the shared suspension, so
+ * readers holding the same stream share every computed prefix and no element is
+ * computed twice. Streams may be unbounded.
+ *
+ *   auto squares = plll::Stream<int>::iterate(1, [](int x) { return x + 1; })
+ *                      .map([](int x) { return x * x; });
+ *   plll::List<int> first_ten = squares.take(10).to_list();
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "lazy.hpp"
+#include "list.hpp"
+
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+namespace plll {
+
+template<typename T, typename Policy>
+class Stream;
+
+////////////////////////////// STREAM CELL
+
+template<typename T, typename Policy = AtomicCount>
+struct StreamCell : RefCounted<StreamCell<T, Policy>, Policy>
+{
+    T _data;
+    Stream<T, Policy> _rest;
+
+    StreamCell(const T& data, const Stream<T, Policy>& rest) : _data(data), _rest(rest) {}
+
+    //A computed stream is a chain of any length, it is freed from a flat worklist
+    static void release(const StreamCell* cell)
+    {
+        if (Policy::decrement(cell->_count)) release_flat(cell);
+    }
+};
+
+////////////////////////////// PERSISTENT LAZY STREAM
+
+template<typename T, typename Policy = AtomicCount>
+class Stream
+{
+    template <typename R, typename P>
+    friend class Stream;
+
+    using Cell = StreamCell<T, Policy>;
+    using Suspension = Lazy<Ref<Cell>, Policy>;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty stream
+        Stream() : cell(Suspension::of(nullptr)) {}
+
+        //A stream starting with |data| followed by |rest|
+        static Stream cons(const T& data, const Stream& rest)
+        {
+            return Stream(Suspension::of(make_ref<Cell>(data, rest)));
+        }
+
+        //A stream computed by |f|, which returns a Stream, the first time it is read
+        template <typename F>
+        static Stream delay(F f)
+        {
+            return Stream(Suspension::delay([f]() mutable { return f().force(); }));
+        }
+
+        //The unbounded stream |seed|, f(|seed|), f(f(|seed|)), ...
+        template <typename F>
+        static Stream iterate(const T& seed, F f)
+        {
+            return cons(seed, delay([seed, f]() { return iterate(f(seed), f); }));
+        }
+
+        //A stream over the elements of |list|, produced as they are read
+        static Stream from_list(const List<T, Policy>& list)
+        {
+            return delay([list]()
+            {
+                if (list.is_empty()) return Stream();
+                return cons(list.front(), from_list(list.pop_front()));
+            });
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //True if the stream is empty, computes the first element
+        bool is_empty() const
+        {
+            return !force();
+        }
+
+        //Returns the first element, computing it if needed
+        //Returns nullptr if the stream is empty
+        ValueRef<T, Policy, Cell> first() const
+        {
+            return ValueRef<T, Policy, Cell>(force());
+        }
+
+        //Returns the first element, computing it if needed
+        //Throws std::out_of_range if the stream is empty
+        const T& front() const
+        {
+            if (is_empty()) throw std::out_of_range("plll::Stream::front on an empty stream");
+
+            return force()->_data;
+        }
+
+        //Returns the stream after the first element
+        //If the stream is empty then the empty stream is returned
+        Stream rest() const
+        {
+            return is_empty() ? Stream() : force()->_rest;
+        }
+
+        //Lazily keeps at most the first |n| elements
+        Stream take(size_t n) const
+        {
+            if (!n) return Stream();
+
+            Stream source(*this);
+
+            return delay_after(source, [source, n]()
+            {
+                if (source.is_empty()) return Stream();
+                return cons(source.front(), source.rest().take(n - 1));
+            });
+        }
+
+        //Lazily skips the first |n| elements
+        Stream drop(size_t n) const
+        {
+            Stream source(*this);
+
+            return delay_after(source, [source, n]()
+            {
+                Stream current = source;
+                for (size_t i = 0; i < n && !current.is_empty(); ++i) current = current.rest();
+                return current;
+            });
+        }
+
+        //Lazily applies |f| to every element
+        //|f| is called as non-const, like List::map calls it, so mutable lambdas may be used
+        template <typename F>
+        Stream<std::decay_t<std::invoke_result_t<F&, const T&>>, Policy> map(F f) const
+        {
+            using Mapped = Stream<std::decay_t<std::invoke_result_t<F&, const T&>>, Policy>;
+            Stream source(*this);
+
+            return Mapped::delay([source, f]() mutable
+            {
+                if (source.is_empty()) return Mapped();
+                return Mapped::cons(f(source.front()), source.rest().map(f));
+            });
+        }
+
+        //Lazily keeps the elements for which |predicate| is true
+        template <typename F>
+        Stream filter(F predicate) const
+        {
+            Stream source(*this);
+
+            return delay_after(source, [source, predicate]() mutable
+            {
+                Stream current = source;
+                while (!current.is_empty() && !predicate(current.front())) current = current.rest();
+
+                if (current.is_empty()) return Stream();
+                return cons(current.front(), current.rest().filter(predicate));
+            });
+        }
+
+        //Lazily pairs the elements of this stream and |other|, ending with the shorter one
+        template <typename U>
+        Stream<std::pair<T, U>, Policy> zip(const Stream<U, Policy>& other) const
+        {
+            using Zipped = Stream<std::pair<T, U>, Policy>;
+            Stream source(*this);
+
+            return Zipped::delay([source, other]()
+            {
+                if (source.is_empty() || other.is_empty()) return Zipped();
+                return Zipped::cons({ source.front(), other.front() }, source.rest().zip(other.rest()));
+            });
+        }
+
+        //Computes every element into a list, the stream must be finite
+        List<T, Policy> to_list() const
+        {
+            typename List<T, Policy>::Transient builder;
+
+            for (Stream current = *this; !current.is_empty(); current = current.rest())
+                builder.push_back(current.front());
+
+            return builder.persistent();
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //the first cell, null once computed if the stream is empty
+        Suspension cell;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        explicit Stream(const Suspension& cell) : cell(cell) {}
+
+        //A stream computed by |f| that reads |source|, forcing it forces |source| first
+        //Streams built on each other, such as repeated drops, are then forced without nesting
+        template <typename F>
+        static Stream delay_after(const Stream& source, F f)
+        {
+            return Stream(Suspension::delay_after(source.cell, [f]() mutable { return f().force(); }));
+        }
+
+        const Ref<Cell>& force() const
+        {
+            return cell.force();
+        }
+};
+
+}
+
+#endif //STREAM_HPP
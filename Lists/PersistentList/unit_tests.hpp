@@ -0,0 +1,1344 @@
+/* @author, Sean Siders, sean.siders@icloud.com */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "nuttiest/nuttiest.hpp"
+using namespace nuttiest;
+
+#ifndef UNIT_TESTS_HPP
+#define UNIT_TESTS_HPP
+
+//Every structure is checked against a std container holding the same items
+class PersistentTests
+{
+    public:
+
+    PersistentTests()
+    {
+        listTests();
+        vectorTests();
+        randomAccessListTests();
+        streamTests();
+        internerTests();
+        serializerTests();
+        viewTests();
+        hamtTests();
+        fingerTreeTests();
+        catenableTests();
+        atomicTests();
+        reclaimerTests();
+        zipperTests();
+        statsTests();
+        queueTests();
+
+        summary();
+    }
+
+    private:
+
+    std::mt19937 random{ 5489 };
+
+    //True if |list| holds exactly the items of |expected|
+    template <typename List, typename T>
+    static bool matches(const List& list, const std::vector<T>& expected)
+    {
+        if (list.length() != expected.size()) return false;
+
+        size_t index = 0;
+        for (const T& item : list) if (!(item == expected[index++])) return false;
+
+        return true;
+    }
+
+    void listTests()
+    {
+        using List = plll::List<int>;
+
+        section("LIST")
+        {
+            unit_test("random edits match std::vector, old versions included")
+            {
+                List list;
+                std::vector<int> expected;
+                std::vector<std::pair<List, std::vector<int>>> history;
+
+                for (int i = 0; i < 3000; ++i)
+                {
+                    size_t index = expected.empty() ? 0 : random() % expected.size();
+
+                    switch (random() % 5)
+                    {
+                        case 0:
+                            list = list.push_front(i);
+                            expected.insert(expected.begin(), i);
+                            break;
+
+                        case 1:
+                            list = list.push_back(i);
+                            expected.push_back(i);
+                            break;
+
+                        case 2:
+                            list = list.insert_at(index, i);
+                            expected.insert(expected.begin() + index, i);
+                            break;
+
+                        case 3:
+                            if (expected.empty()) break;
+                            list = list.remove_at(index);
+                            expected.erase(expected.begin() + index);
+                            break;
+
+                        default:
+                            if (expected.empty()) break;
+                            list = list.pop_front();
+                            expected.erase(expected.begin());
+                    }
+
+                    if (i % 300 == 0) history.emplace_back(list, expected);
+                }
+
+                bool agree = matches(list, expected) && (expected.empty() || list.back() == expected.back());
+                for (const auto& version : history) agree &= matches(version.first, version.second);
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("transient builders")
+            {
+                std::vector<int> items;
+                List::Transient builder;
+
+                for (int i = 0; i < 1000; ++i)
+                {
+                    builder.push_back(i);
+                    items.push_back(i);
+                }
+
+                List built = builder.persistent();
+                List::Transient copy = built.transient();
+
+                copy.push_front(-1);
+                copy.push_back(1000);
+
+                std::vector<int> extended(items);
+                extended.insert(extended.begin(), -1);
+                extended.push_back(1000);
+
+                assert_eq(matches(built, items), true);
+                assert_eq(matches(copy.persistent(), extended), true);
+                assert_eq(matches(List::from_range(items), items), true);
+            }
+
+            unit_test("map, filter and fold")
+            {
+                std::vector<int> items = { 1, 2, 3, 4, 5 };
+                std::vector<int> doubledOdds = { 2, 6, 10 };
+                List list = List::from_range(items);
+
+                assert_eq(matches(list.filter([](int x) { return x % 2; }).map([](int x) { return x * 2; }), doubledOdds), true);
+                assert_eq(list.fold(0, [](int a, int x) { return a + x; }), 15);
+            }
+
+            unit_test("single threaded counting")
+            {
+                using LocalList = plll::List<int, plll::LocalCount>;
+
+                LocalList list;
+                std::vector<int> items, squares;
+
+                for (int i = 0; i < 100; ++i)
+                {
+                    list = list.push_front(i);
+                    items.insert(items.begin(), i);
+                    squares.insert(squares.begin(), i * i);
+                }
+
+                LocalList older = list.pop_front().push_front(-1);
+                auto squared = list.map([](int x) { return x * x; });
+
+                bool agree = true;
+                for (size_t i = 0; i < items.size(); ++i) agree &= list.at(i) == items[i];
+
+                assert_eq(agree, true);
+                assert_eq(older.at(0), -1);
+                assert_eq(older.at(1), 98);
+                assert_eq((std::is_same<decltype(squared), LocalList>::value), true);
+                assert_eq(matches(squared, squares), true);
+                assert_eq(list.pop_front().pop_front().at(0), 97);
+            }
+        }
+    }
+
+    void vectorTests()
+    {
+        using Vector = plll::Vector<int>;
+
+        section("VECTOR")
+        {
+            unit_test("random edits match std::vector, old versions included")
+            {
+                Vector vector;
+                std::vector<int> expected;
+                std::vector<std::pair<Vector, std::vector<int>>> history;
+
+                //enough items for the trie to grow past two levels and shrink back
+                for (int i = 0; i < 40000; ++i)
+                {
+                    int choice = int(random() % 8);
+                    bool growing = i < 20000;
+
+                    if (expected.empty() || choice < (growing ? 5 : 2))
+                    {
+                        vector = vector.push_back(i);
+                        expected.push_back(i);
+                    }
+
+                    else if (choice < (growing ? 7 : 4))
+                    {
+                        size_t index = random() % expected.size();
+
+                        vector = vector.update(index, -i);
+                        expected[index] = -i;
+                    }
+
+                    else
+                    {
+                        vector = vector.pop_back();
+                        expected.pop_back();
+                    }
+
+                    if (i % 4000 == 0) history.emplace_back(vector, expected);
+                }
+
+                bool agree = vectorMatches(vector, expected);
+                for (const auto& version : history) agree &= vectorMatches(version.first, version.second);
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("out of bounds")
+            {
+                Vector vector = Vector(1).push_back(2);
+
+                assert_eq(vector.nth(2) == nullptr, true);
+                assert_eq(*vector.last(), 2);
+                assert_eq(vector.pop_back().pop_back().is_empty(), true);
+            }
+        }
+    }
+
+    //True if |vector| holds exactly the items of |expected|
+    static bool vectorMatches(const plll::Vector<int>& vector, const std::vector<int>& expected)
+    {
+        if (vector.length() != expected.size()) return false;
+
+        for (size_t i = 0; i < expected.size(); ++i)
+            if (*vector.nth(i) != expected[i]) return false;
+
+        return true;
+    }
+
+    void randomAccessListTests()
+    {
+        using RandomAccessList = plll::RandomAccessList<int>;
+
+        section("RANDOM ACCESS LIST")
+        {
+            unit_test("random edits match std::vector, old versions included")
+            {
+                RandomAccessList list;
+                std::vector<int> expected;
+                std::vector<std::pair<RandomAccessList, std::vector<int>>> history;
+
+                //pops split the front tree back onto the spine, so shrinking is exercised as much as growing
+                for (int i = 0; i < 20000; ++i)
+                {
+                    int choice = int(random() % 8);
+                    bool growing = i < 10000;
+
+                    if (expected.empty() || choice < (growing ? 5 : 2))
+                    {
+                        list = list.push_front(i);
+                        expected.insert(expected.begin(), i);
+                    }
+
+                    else if (choice < (growing ? 7 : 4))
+                    {
+                        size_t index = random() % expected.size();
+
+                        list = list.update(index, -i);
+                        expected[index] = -i;
+                    }
+
+                    else
+                    {
+                        list = list.pop_front();
+                        expected.erase(expected.begin());
+                    }
+
+                    if (i % 2000 == 0) history.emplace_back(list, expected);
+                }
+
+                bool agree = indexedMatches(list, expected);
+                for (const auto& version : history) agree &= indexedMatches(version.first, version.second);
+
+                for (size_t i = 0; agree && i < expected.size(); i += 97) agree &= *list.nth(i) == expected[i];
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("out of bounds")
+            {
+                RandomAccessList list = RandomAccessList(1).push_front(2);
+
+                assert_eq(list.nth(2) == nullptr, true);
+                must_throw(list.at(2));
+
+                assert_eq(indexedMatches(list.update(2, 5), { 2, 1 }), true);
+                assert_eq(list.pop_front().pop_front().pop_front().is_empty(), true);
+                must_throw(RandomAccessList().front());
+            }
+        }
+    }
+
+    void streamTests()
+    {
+        using Stream = plll::Stream<int>;
+
+        Stream naturals = Stream::iterate(0, [](int x) { return x + 1; });
+
+        section("STREAM")
+        {
+            unit_test("empty stream")
+            {
+                Stream empty;
+
+                assert_eq(empty.is_empty(), true);
+                assert_eq(empty.rest().is_empty(), true);
+                assert_eq(empty.take(3).to_list().is_empty(), true);
+            }
+
+            unit_test("take, drop and filter")
+            {
+                std::vector<int> evens = { 6, 8, 10, 12 };
+
+                assert_eq(matches(naturals.filter([](int x) { return x % 2 == 0; }).drop(3).take(4).to_list(), evens), true);
+                assert_eq(naturals.drop(100).front(), 100);
+            }
+
+            unit_test("map is computed once per element")
+            {
+                int calls = 0;
+                Stream squares = naturals.map([&calls](int x) { ++calls; return x * x; });
+
+                std::vector<int> expected = { 0, 1, 4, 9, 16 };
+
+                assert_eq(matches(squares.take(5).to_list(), expected), true);
+                assert_eq(matches(squares.take(5).to_list(), expected), true);
+                assert_eq(calls, 5);
+            }
+
+            unit_test("zip ends with the shorter stream")
+            {
+                auto zipped = naturals.zip(naturals.drop(1).take(3)).to_list();
+
+                assert_eq(zipped.length(), 3);
+                assert_eq(zipped.at(2).second, 3);
+            }
+
+            unit_test("from_list")
+            {
+                std::vector<int> items = { 1, 2, 3 };
+                Stream stream = Stream::from_list(plll::List<int>::from_range(items));
+
+                assert_eq(matches(stream.to_list(), items), true);
+                assert_eq(stream.drop(5).is_empty(), true);
+            }
+
+            //Each drop used to force the one below it through nested calls
+            unit_test("deep drop chain")
+            {
+                Stream dropped = naturals;
+                for (int i = 0; i < 1000000; ++i) dropped = dropped.drop(1);
+
+                assert_eq(dropped.front(), 1000000);
+
+                Stream unforced = naturals;
+                for (int i = 0; i < 1000000; ++i) unforced = unforced.drop(1);
+            }
+        }
+    }
+
+    void internerTests()
+    {
+        using List = plll::List<std::string>;
+
+        section("INTERNER")
+        {
+            unit_test("equal lists are identical")
+            {
+                plll::Interner<std::string> interner;
+                std::vector<std::string> abc = { "a", "b", "c" }, xbc = { "x", "b", "c" };
+
+                List a = interner.from_range(abc.begin(), abc.end());
+                List x = interner.from_range(xbc.begin(), xbc.end());
+
+                assert_eq(interner.size(), 4);
+                assert_eq(a.pop_front().identical_to(x.pop_front()), true);
+                assert_eq(interner.intern(List::from_range(abc)).identical_to(a), true);
+                assert_eq(matches(a, abc), true);
+            }
+
+            unit_test("collect drops unreferenced chains")
+            {
+                plll::Interner<std::string> interner;
+                std::vector<std::string> items;
+
+                for (int i = 0; i < 100000; ++i) items.push_back(std::to_string(i % 10));
+
+                List kept = interner.from_range(items.begin() + 50000, items.end());
+                interner.from_range(items.begin(), items.end());
+
+                assert_eq(interner.collect(), 50000);
+                assert_eq(interner.size(), 50000);
+                assert_eq(matches(kept, std::vector<std::string>(items.begin() + 50000, items.end())), true);
+            }
+
+            //A suffix built outside the interner used to be linked in without being interned
+            unit_test("collect after a suffix that was not interned")
+            {
+                plll::Interner<std::string> interner;
+                std::vector<std::string> abc = { "a", "b", "c" };
+
+                List a = interner.from_range(abc.begin(), abc.end());
+                List pushed = interner.push_front(a.push_back("d"), "z");
+
+                a = List();
+                interner.collect();
+
+                std::vector<std::string> expected = { "z", "a", "b", "c", "d" };
+                assert_eq(matches(pushed, expected), true);
+
+                pushed = List();
+                interner.collect();
+                assert_eq(interner.size(), 0);
+            }
+        }
+    }
+
+    void serializerTests()
+    {
+        //Trivially copyable, but with no default constructor
+        struct Point
+        {
+            int x, y;
+
+            Point(int x, int y) : x(x), y(y) {}
+
+            bool operator==(const Point& other) const { return x == other.x && y == other.y; }
+        };
+
+        using List = plll::List<Point>;
+
+        std::vector<Point> points;
+        for (int i = 0; i < 1000; ++i) points.emplace_back(i, -i);
+
+        List base = List::from_range(points);
+        std::vector<List> versions = { base, base.push_front(Point(7, 7)), base.pop_front(), base.remove_at(500), List() };
+
+        std::stringstream stream;
+        plll::Serializer::write(stream, versions);
+        std::string bytes = stream.str();
+
+        section("SERIALIZER")
+        {
+            unit_test("round trip")
+            {
+                auto loaded = plll::Serializer::read<Point>(stream);
+                bool agree = loaded.size() == versions.size();
+
+                for (size_t v = 0; agree && v < versions.size(); ++v)
+                    agree &= matches(loaded[v], std::vector<Point>(versions[v].begin(), versions[v].end()));
+
+                assert_eq(agree, true);
+                assert_eq(&loaded[1].back(), &loaded[0].back());
+                assert_eq(&loaded[2].front(), &loaded[0].at(1));
+            }
+
+            unit_test("mapped file")
+            {
+                const char* path = "unit_tests.bin";
+                std::ofstream(path, std::ios::binary) << bytes;
+
+                bool agree = true;
+
+                {
+                    plll::MappedVersions<Point> mapped(path);
+                    agree &= mapped.count() == versions.size();
+
+                    for (size_t v = 0; agree && v < versions.size(); ++v)
+                    {
+                        agree &= mapped.length(v) == versions[v].length();
+                        agree &= std::equal(mapped.begin(v), mapped.end(v), versions[v].begin(), versions[v].end());
+                    }
+                }
+
+                std::remove(path);
+                assert_eq(agree, true);
+            }
+
+            unit_test("a version entry that does not match its chain is rejected")
+            {
+                //the third field of the first version entry is its length
+                std::string corrupt = bytes;
+                corrupt[corrupt.size() - versions.size() * 3 * sizeof(uint64_t) + 2 * sizeof(uint64_t)] ^= 1;
+
+                std::stringstream in(corrupt);
+                must_throw(plll::Serializer::read<Point>(in));
+            }
+
+            unit_test("a node referring forward is rejected")
+            {
+                std::string corrupt = bytes;
+                uint64_t forward = 2;
+                std::memcpy(&corrupt[sizeof(plll::SerializedHeader) + plll::record_size<Point>() - sizeof(uint64_t)], &forward, sizeof(uint64_t));
+
+                std::stringstream in(corrupt);
+                must_throw(plll::Serializer::read<Point>(in));
+            }
+
+            //Counts picked so that count * record size wraps around to the size of the real file
+            unit_test("huge counts in a mapped file are rejected")
+            {
+                const char* path = "unit_tests.bin";
+                uint64_t nodes = (uint64_t(1) << 60) + (bytes.size() - sizeof(plll::SerializedHeader) - versions.size() * 3 * sizeof(uint64_t)) / plll::record_size<Point>();
+                uint64_t entries = (uint64_t(1) << 61) + versions.size();
+
+                std::ofstream(path, std::ios::binary) << forged(bytes, offsetof(plll::SerializedHeader, node_count), nodes);
+                assert_eq(rejects([&] { plll::MappedVersions<Point> mapped(path); }), true);
+
+                std::ofstream(path, std::ios::binary) << forged(bytes, offsetof(plll::SerializedHeader, version_count), entries);
+                assert_eq(rejects([&] { plll::MappedVersions<Point> mapped(path); }), true);
+
+                std::remove(path);
+            }
+
+            unit_test("a truncated stream with a huge count is rejected")
+            {
+                std::string header = bytes.substr(0, sizeof(plll::SerializedHeader));
+
+                std::stringstream nodes(forged(header, offsetof(plll::SerializedHeader, node_count), ~uint64_t(0)));
+                assert_eq(rejects([&] { plll::Serializer::read<Point>(nodes); }), true);
+
+                std::stringstream entries(forged(header, offsetof(plll::SerializedHeader, version_count), ~uint64_t(0)));
+                assert_eq(rejects([&] { plll::Serializer::read<Point>(entries); }), true);
+            }
+        }
+    }
+
+    //|bytes| with the header field at |offset| overwritten by |value|
+    static std::string forged(std::string bytes, size_t offset, uint64_t value)
+    {
+        std::memcpy(&bytes[offset], &value, sizeof(value));
+        return bytes;
+    }
+
+    //Whether |load| fails with the std::runtime_error the serializer documents, rather than anything else
+    template <typename F>
+    static bool rejects(F load)
+    {
+        try { load(); }
+        catch (const std::runtime_error&) { return true; }
+        catch (...) {}
+
+        return false;
+    }
+
+    void viewTests()
+    {
+        using List = plll::List<int>;
+
+        std::vector<int> items;
+        for (int i = 0; i < 100000; ++i) items.push_back(int(random() % 1000));
+
+        List list = List::from_range(items);
+
+        section("VIEW")
+        {
+            unit_test("fused pipeline matches the std algorithms")
+            {
+                std::vector<int> expected;
+
+                for (int item : items)
+                    if ((item * 3) % 2 == 0) expected.push_back(item * 3 + 1);
+
+                auto result = plll::view(list).map([](int x) { return x * 3; }).filter([](int x) { return x % 2 == 0; })
+                                              .map([](int x) { return x + 1; }).to_list();
+
+                assert_eq(matches(result, expected), true);
+            }
+
+            unit_test("fold and map_reduce")
+            {
+                long long expected = 0;
+                for (int item : items) expected += item;
+
+                assert_eq(plll::view(list).fold(0LL, [](long long a, int x) { return a + x; }), expected);
+                assert_eq(plll::map_reduce(list, 0LL, [](int x) { return (long long)x; }, [](long long a, long long b) { return a + b; }, 4), expected);
+            }
+
+            //every chunk used to call the same |map| object, racing on its scratch slot
+            unit_test("map_reduce with stateful callables")
+            {
+                long long expected = 0;
+                for (int item : items) expected += item;
+
+                auto staged = [scratch = std::vector<long long>(1)](int x) mutable { scratch[0] = x; return scratch[0]; };
+
+                assert_eq(plll::map_reduce(list, 0LL, staged, [](long long a, long long b) { return a + b; }, 4), expected);
+            }
+
+            //map used to compute its result type for a non-const |f| and call it as const
+            unit_test("mutable lambdas")
+            {
+                std::vector<int> numbered = { 0, 1, 2 };
+                List three = List::from_range(std::vector<int>{ 7, 7, 7 });
+
+                assert_eq(matches(plll::view(three).map([n = 0](int) mutable { return n++; }).to_list(), numbered), true);
+                assert_eq(matches(three.map([n = 0](int) mutable { return n++; }), numbered), true);
+
+                auto everyOther = plll::view(three).filter([keep = false](int) mutable { return keep = !keep; }).to_list();
+                assert_eq(everyOther.length(), 2);
+
+                auto streamed = plll::Stream<int>::from_list(three).map([n = 0](int x) mutable { return x + n++; });
+                assert_eq(streamed.front(), 7);
+            }
+        }
+    }
+
+    //Hashes every key to one of four values, so most keys end up in collision nodes
+    struct CollidingHash
+    {
+        size_t operator()(int key) const { return std::hash<int>()(key) % 4; }
+    };
+
+    //True if |map| holds exactly the pairs of |expected|, by lookup and by iteration
+    template <typename Map>
+    static bool mapMatches(const Map& map, const std::unordered_map<int, int>& expected)
+    {
+        if (map.size() != expected.size()) return false;
+
+        for (const auto& pair : expected)
+        {
+            const int* value = map.get(pair.first);
+            if (!value || *value != pair.second) return false;
+        }
+
+        size_t visited = 0;
+
+        for (const auto& pair : map)
+        {
+            auto found = expected.find(pair.first);
+            if (found == expected.end() || found->second != pair.second) return false;
+            ++visited;
+        }
+
+        return visited == expected.size();
+    }
+
+    //Random updates, checking every version kept along the way once they are done
+    template <typename Map>
+    bool mapHistoryMatches(int keys)
+    {
+        Map map;
+        std::unordered_map<int, int> expected;
+
+        std::vector<std::pair<Map, std::unordered_map<int, int>>> history;
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            int key = int(random() % keys);
+
+            if (random() % 3)
+            {
+                map = map.assoc(key, i);
+                expected[key] = i;
+            }
+
+            else
+            {
+                map = map.dissoc(key);
+                expected.erase(key);
+            }
+
+            if (i % 1000 == 0) history.emplace_back(map, expected);
+        }
+
+        bool agree = mapMatches(map, expected);
+        for (const auto& version : history) agree &= mapMatches(version.first, version.second);
+
+        return agree;
+    }
+
+    void hamtTests()
+    {
+        using Map = plll::Map<int, int>;
+        using CollidingMap = plll::Map<int, int, plll::AtomicCount, CollidingHash>;
+
+        section("HAMT")
+        {
+            unit_test("assoc and dissoc match std::unordered_map")
+            {
+                assert_eq(mapHistoryMatches<Map>(5000), true);
+            }
+
+            unit_test("colliding hashes")
+            {
+                assert_eq(mapHistoryMatches<CollidingMap>(300), true);
+            }
+
+            unit_test("a transient leaves the map it started from unchanged")
+            {
+                std::unordered_map<int, int> before, after;
+                Map::Transient builder;
+
+                for (int key = 0; key < 10000; ++key)
+                {
+                    builder.assoc(key, key);
+                    before[key] = key;
+                }
+
+                Map original = builder.persistent();
+                Map::Transient editor = original.transient();
+                after = before;
+
+                for (int key = 0; key < 10000; key += 3)
+                {
+                    editor.dissoc(key);
+                    editor.assoc(key + 1, -key);
+
+                    after.erase(key);
+                    after[key + 1] = -key;
+                }
+
+                Map edited = editor.persistent();
+
+                assert_eq(mapMatches(original, before), true);
+                assert_eq(mapMatches(edited, after), true);
+                assert_eq(builder.size(), 0);
+            }
+
+            unit_test("a moved transient edits in place")
+            {
+                std::unordered_map<int, int> expected;
+                Map map;
+
+                for (int round = 0; round < 5; ++round)
+                {
+                    Map::Transient builder = std::move(map).transient();
+
+                    for (int i = 0; i < 2000; ++i)
+                    {
+                        int key = int(random() % 3000);
+
+                        if (random() % 4)
+                        {
+                            builder.assoc(key, i);
+                            expected[key] = i;
+                        }
+
+                        else
+                        {
+                            builder.dissoc(key);
+                            expected.erase(key);
+                        }
+                    }
+
+                    map = builder.persistent();
+                }
+
+                assert_eq(mapMatches(map, expected), true);
+            }
+
+            unit_test("removing every key leaves an empty map")
+            {
+                std::vector<int> keys;
+                for (int key = 0; key < 1000; ++key) keys.push_back(key);
+
+                plll::Set<int> set = plll::Set<int>::from_range(keys.begin(), keys.end());
+                for (int key : keys) set = set.erase(key);
+
+                assert_eq(set.is_empty(), true);
+                assert_eq(set.begin() == set.end(), true);
+            }
+        }
+    }
+
+    //True if |sequence| holds exactly the items of |expected|, read by index
+    template <typename Sequence>
+    static bool indexedMatches(const Sequence& sequence, const std::vector<int>& expected)
+    {
+        if (sequence.length() != expected.size()) return false;
+
+        for (size_t i = 0; i < expected.size(); ++i)
+            if (sequence.at(i) != expected[i]) return false;
+
+        return true;
+    }
+
+    void fingerTreeTests()
+    {
+        using Sequence = plll::Sequence<int>;
+
+        section("FINGER TREE")
+        {
+            unit_test("random edits match std::vector, old versions included")
+            {
+                Sequence sequence;
+                std::vector<int> expected;
+                std::vector<std::pair<Sequence, std::vector<int>>> history;
+
+                for (int i = 0; i < 5000; ++i)
+                {
+                    size_t index = expected.empty() ? 0 : random() % expected.size();
+
+                    switch (random() % 7)
+                    {
+                        case 0:
+                            sequence = sequence.push_front(i);
+                            expected.insert(expected.begin(), i);
+                            break;
+
+                        case 1:
+                        case 2:
+                            sequence = sequence.push_back(i);
+                            expected.push_back(i);
+                            break;
+
+                        case 3:
+                            sequence = sequence.insert_at(index, i);
+                            expected.insert(expected.begin() + index, i);
+                            break;
+
+                        case 4:
+                            if (expected.empty()) break;
+                            sequence = sequence.remove_at(index);
+                            expected.erase(expected.begin() + index);
+                            break;
+
+                        case 5:
+                            if (expected.empty()) break;
+                            sequence = sequence.update(index, -i);
+                            expected[index] = -i;
+                            break;
+
+                        default:
+                            if (expected.empty()) break;
+
+                            if (random() % 2)
+                            {
+                                sequence = sequence.pop_front();
+                                expected.erase(expected.begin());
+                            }
+
+                            else
+                            {
+                                sequence = sequence.pop_back();
+                                expected.pop_back();
+                            }
+                    }
+
+                    if (i % 500 == 0) history.emplace_back(sequence, expected);
+                }
+
+                bool agree = indexedMatches(sequence, expected);
+                for (const auto& version : history) agree &= indexedMatches(version.first, version.second);
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("split and concat")
+            {
+                std::vector<int> items;
+                for (int i = 0; i < 3000; ++i) items.push_back(i);
+
+                Sequence sequence = Sequence::from_range(items.begin(), items.end());
+                bool agree = true;
+
+                for (size_t index = 0; index <= items.size(); index += 251)
+                {
+                    auto parts = sequence.split_at(index);
+
+                    agree &= indexedMatches(parts.first, std::vector<int>(items.begin(), items.begin() + index));
+                    agree &= indexedMatches(parts.second, std::vector<int>(items.begin() + index, items.end()));
+                    agree &= indexedMatches(parts.first.concat(parts.second), items);
+                }
+
+                std::vector<int> twice(items);
+                twice.insert(twice.end(), items.begin(), items.end());
+
+                assert_eq(agree, true);
+                assert_eq(indexedMatches(sequence.concat(sequence), twice), true);
+            }
+        }
+    }
+
+    //True if popping every item off |list| yields the items of |expected|
+    template <typename List>
+    static bool poppedMatches(List list, const std::vector<int>& expected)
+    {
+        if (list.length() != expected.size()) return false;
+
+        for (int item : expected)
+        {
+            if (list.is_empty() || list.front() != item) return false;
+            list = list.pop_front();
+        }
+
+        return list.is_empty();
+    }
+
+    void catenableTests()
+    {
+        using List = plll::CatenableList<int>;
+
+        section("CATENABLE LIST")
+        {
+            unit_test("random concat, push and pop match std::vector")
+            {
+                std::vector<std::pair<List, std::vector<int>>> pool(8);
+                bool agree = true;
+
+                for (int i = 0; i < 5000; ++i)
+                {
+                    auto& target = pool[random() % pool.size()];
+                    const auto& other = pool[random() % pool.size()];
+
+                    switch (random() % 4)
+                    {
+                        case 0:
+                            target.first = target.first.push_front(i);
+                            target.second.insert(target.second.begin(), i);
+                            break;
+
+                        case 1:
+                            target.first = target.first.push_back(i);
+                            target.second.push_back(i);
+                            break;
+
+                        case 2:
+                        {
+                            //|other| may be |target| itself
+                            std::vector<int> joined(target.second);
+                            joined.insert(joined.end(), other.second.begin(), other.second.end());
+
+                            if (joined.size() > 2000) break;
+
+                            target.first = target.first.concat(other.first);
+                            target.second = joined;
+                            break;
+                        }
+
+                        default:
+                            if (target.second.empty()) break;
+                            target.first = target.first.pop_front();
+                            target.second.erase(target.second.begin());
+                    }
+                }
+
+                for (const auto& entry : pool) agree &= poppedMatches(entry.first, entry.second);
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("popping an old version again")
+            {
+                std::vector<int> items;
+                List list;
+
+                for (int i = 0; i < 1000; ++i)
+                {
+                    list = i % 2 ? list.push_back(i) : List(i).concat(list);
+                    items.insert(i % 2 ? items.end() : items.begin(), i);
+                }
+
+                List popped = list.pop_front().pop_front();
+
+                assert_eq(poppedMatches(list, items), true);
+                assert_eq(poppedMatches(popped, std::vector<int>(items.begin() + 2, items.end())), true);
+            }
+        }
+    }
+    void atomicTests()
+    {
+        using List = plll::List<int>;
+
+        section("ATOMIC")
+        {
+            //Version |v| is the list v - 1, ..., 1, 0, so every snapshot can be checked against its own number
+            unit_test("concurrent readers see whole versions")
+            {
+                const int published = 2000;
+                plll::Atomic<List> root;
+
+                std::atomic<int> torn{ 0 }, backwards{ 0 };
+                std::vector<std::thread> readers;
+
+                for (int r = 0; r < 4; ++r)
+                {
+                    readers.emplace_back([&]
+                    {
+                        uint64_t last = 0;
+
+                        for (;;)
+                        {
+                            plll::Snapshot<List> snapshot = root.load_versioned();
+
+                            if (snapshot.version < last) ++backwards;
+                            if (snapshot.value.length() != snapshot.version) ++torn;
+                            else if (snapshot.version && snapshot.value.front() != int(snapshot.version) - 1) ++torn;
+
+                            last = snapshot.version;
+                            if (last == uint64_t(published)) break;
+                        }
+                    });
+                }
+
+                for (int i = 0; i < published; ++i)
+                    root.update([](const List& list) { return list.push_front(int(list.length())); });
+
+                for (auto& reader : readers) reader.join();
+
+                assert_eq(torn.load(), 0);
+                assert_eq(backwards.load(), 0);
+            }
+
+            unit_test("update sees the latest version")
+            {
+                plll::Atomic<List> root;
+                std::vector<int> expected;
+                bool agree = true;
+
+                for (int i = 0; i < 100; ++i)
+                {
+                    List next = root.update([i](const List& list) { return list.push_front(i); });
+                    expected.insert(expected.begin(), i);
+
+                    agree &= root.version() == uint64_t(i + 1);
+                    agree &= matches(next, expected);
+                }
+
+                assert_eq(agree, true);
+                assert_eq(matches(root.load(), expected), true);
+            }
+
+            unit_test("compare_exchange against a stale and the current version")
+            {
+                plll::Atomic<List> root(List(1));
+                root.store(List(2));
+
+                assert_eq(root.compare_exchange(0, List(3)), false);
+                assert_eq(root.version(), uint64_t(1));
+                assert_eq(root.load().front(), 2);
+
+                assert_eq(root.compare_exchange(1, List(3)), true);
+                assert_eq(root.version(), uint64_t(2));
+                assert_eq(root.load().front(), 3);
+            }
+
+            unit_test("history keeps the last replaced versions, newest first")
+            {
+                plll::Atomic<List> root(List(0), 3);
+                for (int i = 1; i <= 5; ++i) root.store(List(i));
+
+                auto history = root.history();
+                assert_eq(history.size(), size_t(3));
+
+                bool ordered = history.size() == 3;
+                for (size_t h = 0; ordered && h < history.size(); ++h)
+                    ordered &= history[h].version == 4 - h && history[h].value.front() == int(4 - h);
+
+                assert_eq(ordered, true);
+
+                plll::Atomic<List> forgetful(List(0));
+                forgetful.store(List(1));
+                assert_eq(forgetful.history().empty(), true);
+            }
+        }
+    }
+    void reclaimerTests()
+    {
+        using List = plll::List<int>;
+
+        section("RECLAIMER")
+        {
+            unit_test("retired versions are dropped on the worker thread")
+            {
+                std::atomic<int> dropped{ 0 }, on_caller{ 0 };
+                std::thread::id caller = std::this_thread::get_id();
+
+                {
+                    plll::Reclaimer reclaimer;
+
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        reclaimer.retire(std::shared_ptr<int>(new int(i), [&](int* item)
+                        {
+                            if (std::this_thread::get_id() == caller) ++on_caller;
+                            ++dropped;
+                            delete item;
+                        }));
+                    }
+                }
+
+                assert_eq(dropped.load(), 3);
+                assert_eq(on_caller.load(), 0);
+            }
+
+            unit_test("retiring versions keeps the nodes they share")
+            {
+                std::vector<int> items;
+                for (int i = 0; i < 1000; ++i) items.push_back(i);
+
+                List base = List::from_range(items);
+
+                {
+                    plll::Reclaimer reclaimer;
+
+                    for (int i = 0; i < 100; ++i)
+                    {
+                        List version = base.push_front(i);
+                        reclaimer.retire(version);
+                        reclaimer.retire(std::move(version));
+                    }
+
+                    reclaimer.retire(List(base));
+                }
+
+                assert_eq(matches(base, items), true);
+            }
+
+            //Node::release used to recurse once per node and overflow the stack
+            unit_test("dropping a multi-million node list")
+            {
+                std::vector<int> items(3000000, 7);
+
+                {
+                    List list = List::from_range(items);
+                    assert_eq(list.length(), items.size());
+                }
+
+                {
+                    plll::Reclaimer reclaimer;
+                    reclaimer.retire(List::from_range(items));
+                }
+            }
+        }
+    }
+    void zipperTests()
+    {
+        using Zipper = plll::Zipper<int>;
+
+        section("ZIPPER")
+        {
+            //|expected| holds the items and |focus| the index the zipper should be on
+            unit_test("random edits match std::vector, old versions included")
+            {
+                Zipper zipper;
+                std::vector<int> expected;
+                size_t focus = 0;
+
+                std::vector<std::pair<Zipper, std::vector<int>>> history;
+                bool agree = true;
+
+                for (int i = 0; i < 5000; ++i)
+                {
+                    switch (random() % 6)
+                    {
+                        case 0:
+                            zipper = zipper.insert(i);
+                            expected.insert(expected.begin() + focus, i);
+                            break;
+
+                        case 1:
+                            zipper = zipper.remove();
+                            if (focus < expected.size()) expected.erase(expected.begin() + focus);
+                            break;
+
+                        case 2:
+                            zipper = zipper.replace(-i);
+                            if (focus < expected.size()) expected[focus] = -i;
+                            break;
+
+                        case 3:
+                            focus = random() % (expected.size() + 2);
+                            zipper = zipper.move_to(focus);
+                            focus = std::min(focus, expected.size());
+                            break;
+
+                        case 4:
+                            zipper = zipper.move_left();
+                            if (focus) --focus;
+                            break;
+
+                        default:
+                            zipper = zipper.move_right();
+                            if (focus < expected.size()) ++focus;
+                    }
+
+                    agree &= zipper.position() == focus && zipper.length() == expected.size();
+                    agree &= focus < expected.size() ? zipper.front() == expected[focus] : zipper.at_end();
+
+                    if (i % 500 == 0) history.emplace_back(zipper, expected);
+                }
+
+                agree &= matches(zipper.to_list(), expected);
+                for (const auto& version : history) agree &= matches(version.first.to_list(), version.second);
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("the ends of the list")
+            {
+                Zipper zipper(plll::List<int>::from_range(std::vector<int>{ 1, 2, 3 }));
+
+                assert_eq(zipper.move_left().position(), size_t(0));
+                assert_eq(zipper.move_left().front(), 1);
+
+                Zipper end = zipper.move_to(10);
+                assert_eq(end.position(), size_t(3));
+                assert_eq(end.at_end(), true);
+                assert_eq(end.focus() == nullptr, true);
+                must_throw(end.front());
+
+                assert_eq(matches(end.remove().to_list(), std::vector<int>{ 1, 2, 3 }), true);
+                assert_eq(matches(end.replace(9).to_list(), std::vector<int>{ 1, 2, 3 }), true);
+                assert_eq(matches(end.insert(4).to_list(), std::vector<int>{ 1, 2, 3, 4 }), true);
+                assert_eq(matches(end.move_left().remove().to_list(), std::vector<int>{ 1, 2 }), true);
+                assert_eq(end.move_right().position(), size_t(3));
+            }
+        }
+    }
+    void statsTests()
+    {
+        using List = plll::List<int>;
+
+        section("SHARING STATS")
+        {
+            //b and c share a's nodes from 1 and 2 on, each adds one node of its own
+            unit_test("versions sharing suffixes")
+            {
+                List a = List::from_range(std::vector<int>{ 1, 2, 3, 4 });
+                List b = a.push_front(0);
+                List c = a.pop_front().push_front(9);
+
+                auto stats = plll::SharingStats::measure(std::vector<List>{ a, b, c });
+
+                assert_eq(stats.versions, size_t(3));
+                assert_eq(stats.logical_nodes, size_t(13));
+                assert_eq(stats.unique_nodes, size_t(6));
+                assert_eq(stats.shared_nodes, size_t(4));
+                assert_eq(stats.exclusive_nodes, size_t(2));
+                assert_eq(stats.bytes, 6 * sizeof(plll::Node<int, plll::AtomicCount>));
+                assert_eq(stats.sharing_ratio(), 1 - 6.0 / 13);
+            }
+
+            unit_test("unshared and repeated versions")
+            {
+                List a = List::from_range(std::vector<int>{ 1, 2, 3 });
+                List b = List::from_range(std::vector<int>{ 1, 2 });
+
+                auto apart = plll::SharingStats::measure(std::vector<List>{ a, b, List() });
+                assert_eq(apart.unique_nodes, size_t(5));
+                assert_eq(apart.shared_nodes, size_t(0));
+                assert_eq(apart.sharing_ratio(), 0.0);
+
+                auto twice = plll::SharingStats::measure(std::vector<List>{ a, a });
+                assert_eq(twice.logical_nodes, size_t(6));
+                assert_eq(twice.unique_nodes, size_t(3));
+                assert_eq(twice.shared_nodes, size_t(3));
+                assert_eq(twice.exclusive_nodes, size_t(0));
+
+                auto none = plll::SharingStats::measure(std::vector<List>());
+                assert_eq(none.unique_nodes, size_t(0));
+                assert_eq(none.average_refcount(), 0.0);
+            }
+        }
+    }
+    void queueTests()
+    {
+        using Queue = plll::Queue<int>;
+
+        section("QUEUE")
+        {
+            //old versions are saved mid rotation and drained after the queue has moved on
+            unit_test("random edits match std::deque, old versions included")
+            {
+                Queue queue;
+                std::deque<int> expected;
+                std::vector<std::pair<Queue, std::deque<int>>> history;
+                bool agree = true;
+
+                for (int i = 0; i < 20000; ++i)
+                {
+                    if (expected.empty() || random() % 5 < 3)
+                    {
+                        queue = queue.push_back(i);
+                        expected.push_back(i);
+                    }
+
+                    else
+                    {
+                        queue = queue.pop_front();
+                        expected.pop_front();
+                    }
+
+                    agree &= queue.length() == expected.size();
+                    agree &= expected.empty() ? queue.is_empty() : queue.front() == expected.front();
+
+                    if (i % 1500 == 0) history.emplace_back(queue, expected);
+                }
+
+                agree &= poppedMatches(queue, std::vector<int>(expected.begin(), expected.end()));
+
+                //each saved version is drained twice, the first drain must not disturb the second
+                for (const auto& version : history)
+                {
+                    std::vector<int> items(version.second.begin(), version.second.end());
+
+                    agree &= poppedMatches(version.first, items);
+                    agree &= poppedMatches(version.first, items);
+                }
+
+                assert_eq(agree, true);
+            }
+
+            unit_test("empty queue")
+            {
+                Queue queue;
+
+                assert_eq(queue.first() == nullptr, true);
+                must_throw(queue.front());
+                assert_eq(queue.pop_front().is_empty(), true);
+                assert_eq(queue.push_back(1).pop_front().push_back(2).front(), 2);
+            }
+        }
+    }
+};
+
+#endif //UNIT_TESTS_HPP
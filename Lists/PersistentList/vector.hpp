@@ -0,0 +1,319 @@
+/*
+ * Persistent vector implemented as a 32-way bitmapped trie with a tail buffer.
+ * Every operation returns a new version that shares all untouched nodes with
+ * the version it was derived from, so push_back, pop_back, nth and update
+ * only ever copy a single root-to-leaf path (O(log32 N)).
+ *
+ * The last (up to) 32 elements live in |tail| outside of the trie, which makes
+ * push_back and pop_back touch the trie only once every 32 operations.
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <memory>
+#include <vector>
+
+#ifndef VECTOR_HPP
+#define VECTOR_HPP
+
+namespace plll {
+
+////////////////////////////// VECTOR NODE
+
+//A node of the trie is either a branch (only |_children| is used) or a leaf (only |_data| is used)
+template<typename T>
+struct VectorNode
+{
+    std::vector<std::shared_ptr<const VectorNode<T>>> _children;
+    std::vector<T> _data;
+};
+
+////////////////////////////// PERSISTENT VECTOR
+
+template<typename T>
+class Vector
+{
+    using NodePtr = std::shared_ptr<const VectorNode<T>>;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates an empty vector
+        Vector() : tail(std::make_shared<VectorNode<T>>()), shift(BITS), vector_length(0) {}
+
+        //Creates a vector with a single element whose value is |data|
+        explicit Vector(const T& data) : Vector()
+        {
+            auto leaf = std::make_shared<VectorNode<T>>();
+            leaf->_data.push_back(data);
+            tail = leaf;
+            vector_length = 1;
+        }
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of elements in the vector
+        size_t length() const
+        {
+            return vector_length;
+        }
+
+        //True if the vector is empty, otherwise false
+        bool is_empty() const
+        {
+            return !vector_length;
+        }
+
+        //Returns the first element in the vector
+        //Returns nullptr if the vector is empty
+        std::shared_ptr<const T> first() const
+        {
+            return nth(0);
+        }
+
+        //Returns the last element in the vector
+        //Returns nullptr if the vector is empty
+        std::shared_ptr<const T> last() const
+        {
+            return is_empty() ? nullptr : nth(vector_length - 1);
+        }
+
+        //Returns the nth element in the vector
+        //Returns nullptr if |n| is out of bounds
+        //The returned pointer keeps the leaf holding the element alive
+        std::shared_ptr<const T> nth(size_t n) const
+        {
+            if (n >= vector_length) return nullptr;
+
+            NodePtr leaf = leaf_for(n);
+
+            return std::shared_ptr<const T>(leaf, &leaf->_data[n & MASK]);
+        }
+
+        //Pushes a new element containing |data| to the back of the vector
+        Vector<T> push_back(const T& data) const
+        {
+            Vector new_vector(*this);
+
+            //room in the tail, only the tail is copied
+            if (vector_length - tail_offset() < WIDTH)
+            {
+                auto new_tail = std::make_shared<VectorNode<T>>(*tail);
+                new_tail->_data.push_back(data);
+                new_vector.tail = new_tail;
+                ++new_vector.vector_length;
+
+                return new_vector;
+            }
+
+            //the tail is full, push it into the trie
+            //if the root is full, grow the trie by one level
+            if ((vector_length >> BITS) > (size_t(1) << shift))
+            {
+                auto new_root = std::make_shared<VectorNode<T>>();
+                new_root->_children.push_back(root);
+                new_root->_children.push_back(new_path(shift, tail));
+                new_vector.root = new_root;
+                new_vector.shift = shift + BITS;
+            }
+
+            else new_vector.root = push_tail(vector_length, shift, root, tail);
+
+            auto new_tail = std::make_shared<VectorNode<T>>();
+            new_tail->_data.reserve(WIDTH);
+            new_tail->_data.push_back(data);
+            new_vector.tail = new_tail;
+            ++new_vector.vector_length;
+
+            return new_vector;
+        }
+
+        //Replaces the element at |index| with |data|
+        //If |index| is out of bounds then nothing will happen
+        Vector<T> update(size_t index, const T& data) const
+        {
+            if (index >= vector_length) return *this;
+
+            Vector new_vector(*this);
+
+            //the element lives in the tail
+            if (index >= tail_offset())
+            {
+                auto new_tail = std::make_shared<VectorNode<T>>(*tail);
+                new_tail->_data[index & MASK] = data;
+                new_vector.tail = new_tail;
+
+                return new_vector;
+            }
+
+            new_vector.root = assoc(shift, root, index, data);
+
+            return new_vector;
+        }
+
+        //Removes the last element of the vector
+        //If the vector is empty then nothing will happen
+        Vector<T> pop_back() const
+        {
+            if (is_empty()) return *this;
+
+            if (vector_length == 1) return Vector();
+
+            Vector new_vector(*this);
+            --new_vector.vector_length;
+
+            //more than one element in the tail, only the tail is copied
+            if (vector_length - tail_offset() > 1)
+            {
+                auto new_tail = std::make_shared<VectorNode<T>>(*tail);
+                new_tail->_data.pop_back();
+                new_vector.tail = new_tail;
+
+                return new_vector;
+            }
+
+            //the tail is emptied, the rightmost leaf of the trie becomes the new tail
+            new_vector.tail = leaf_for(vector_length - 2);
+            new_vector.root = pop_tail(vector_length, shift, root);
+
+            //collapse a root that is left with a single child
+            if (shift > BITS && new_vector.root && new_vector.root->_children.size() == 1)
+            {
+                new_vector.root = new_vector.root->_children[0];
+                new_vector.shift = shift - BITS;
+            }
+
+            return new_vector;
+        }
+
+    private:
+
+        //////////////// CONSTANTS
+
+        //Bits of the index consumed by every level of the trie
+        static constexpr size_t BITS = 5;
+
+        //Number of children per branch and elements per leaf
+        static constexpr size_t WIDTH = size_t(1) << BITS;
+
+        static constexpr size_t MASK = WIDTH - 1;
+
+        //////////////// DATA
+
+        //top of the trie, null while all elements fit in |tail|
+        NodePtr root;
+
+        //the last (up to WIDTH) elements of the vector
+        NodePtr tail;
+
+        //the number of index bits below the root's level
+        size_t shift;
+
+        //the number of elements currently in the vector
+        size_t vector_length;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        //Index of the first element held in |tail|
+        size_t tail_offset() const
+        {
+            return vector_length < WIDTH ? 0 : ((vector_length - 1) >> BITS) << BITS;
+        }
+
+        //Returns the leaf (or the tail) holding the element at |index|
+        NodePtr leaf_for(size_t index) const
+        {
+            if (index >= tail_offset()) return tail;
+
+            const VectorNode<T>* current = root.get();
+
+            for (size_t level = shift; level > BITS; level -= BITS)
+                current = current->_children[(index >> level) & MASK].get();
+
+            return current->_children[(index >> BITS) & MASK];
+        }
+
+        //Build a chain of single-child branches |level| deep ending in |leaf|
+        static NodePtr new_path(size_t level, const NodePtr& leaf)
+        {
+            if (level == 0) return leaf;
+
+            auto branch = std::make_shared<VectorNode<T>>();
+            branch->_children.push_back(new_path(level - BITS, leaf));
+
+            return branch;
+        }
+
+        //Copy the path to the rightmost slot of |parent| and place |leaf| there
+        //|length| is the length of the vector before the push
+        static NodePtr push_tail(size_t length, size_t level, const NodePtr& parent, const NodePtr& leaf)
+        {
+            auto branch = parent ? std::make_shared<VectorNode<T>>(*parent) : std::make_shared<VectorNode<T>>();
+            size_t sub_index = ((length - 1) >> level) & MASK;
+
+            NodePtr insert;
+
+            if (level == BITS) insert = leaf;
+
+            else if (sub_index < branch->_children.size())
+                insert = push_tail(length, level - BITS, branch->_children[sub_index], leaf);
+
+            else insert = new_path(level - BITS, leaf);
+
+            if (sub_index < branch->_children.size()) branch->_children[sub_index] = insert;
+            else branch->_children.push_back(insert);
+
+            return branch;
+        }
+
+        //Copy the path to the element at |index| and replace it with |data|
+        static NodePtr assoc(size_t level, const NodePtr& node, size_t index, const T& data)
+        {
+            auto copy = std::make_shared<VectorNode<T>>(*node);
+
+            if (level == 0)
+            {
+                copy->_data[index & MASK] = data;
+                return copy;
+            }
+
+            size_t sub_index = (index >> level) & MASK;
+            copy->_children[sub_index] = assoc(level - BITS, node->_children[sub_index], index, data);
+
+            return copy;
+        }
+
+        //Copy the path to the rightmost leaf of |node| with that leaf removed
+        //|length| is the length of the vector before the pop
+        //Returns null if the subtree becomes empty
+        static NodePtr pop_tail(size_t length, size_t level, const NodePtr& node)
+        {
+            size_t sub_index = ((length - 2) >> level) & MASK;
+
+            if (level > BITS)
+            {
+                NodePtr child = pop_tail(length, level - BITS, node->_children[sub_index]);
+
+                if (!child && sub_index == 0) return nullptr;
+
+                auto copy = std::make_shared<VectorNode<T>>(*node);
+
+                if (child) copy->_children[sub_index] = child;
+                else copy->_children.pop_back();
+
+                return copy;
+            }
+
+            if (sub_index == 0) return nullptr;
+
+            auto copy = std::make_shared<VectorNode<T>>(*node);
+            copy->_children.pop_back();
+
+            return copy;
+        }
+};
+
+}
+
+#endif //VECTOR_HPP
@@ -0,0 +1,206 @@
+/*
+ * Lazy view pipelines and parallel map/reduce over plll::List.
+ *
+ * A view records the transformations chained on it (map, filter) without
+ * building any intermediate list. They are fused into a single stage that
+ * runs once per source item when the view is consumed by to_list, fold or
+ * for_each, so a chain of maps costs one pass and one allocation per result.
+ *
+ *   auto totals = plll::view(list).map(f).filter(p).map(g).to_list();
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "list.hpp"
+
+#ifndef VIEW_HPP
+#define VIEW_HPP
+
+namespace plll {
+
+////////////////////////////// STAGES
+
+//The stage of a fresh view, every item is passed on unchanged
+struct IdentityStage
+{
+    template <typename T, typename Sink>
+    void operator()(const T& item, Sink&& sink) const
+    {
+        sink(item);
+    }
+};
+
+//Applies |f| to every item produced by |previous|
+//|f| is called as non-const, like List::map calls it, so mutable lambdas may be used
+template <typename Previous, typename F>
+struct MapStage
+{
+    Previous previous;
+    mutable F f;
+
+    template <typename T, typename Sink>
+    void operator()(const T& item, Sink&& sink) const
+    {
+        previous(item, [&](const auto& value) { sink(f(value)); });
+    }
+};
+
+//Only passes on the items produced by |previous| for which |predicate| is true
+//|predicate| is called as non-const, like List::filter calls it
+template <typename Previous, typename F>
+struct FilterStage
+{
+    Previous previous;
+    mutable F predicate;
+
+    template <typename T, typename Sink>
+    void operator()(const T& item, Sink&& sink) const
+    {
+        previous(item, [&](const auto& value) { if (predicate(value)) sink(value); });
+    }
+};
+
+////////////////////////////// VIEW
+
+//|Out| is the type of the items the view produces
+template <typename T, typename Policy, typename Out, typename Stage>
+class View
+{
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        View(const List<T, Policy>& source, Stage stage) : source(source), stage(std::move(stage)) {}
+
+        //////////////// TRANSFORMATIONS
+
+        //Lazily applies |f| to every item of the view
+        template <typename F>
+        View<T, Policy, std::decay_t<std::invoke_result_t<F&, const Out&>>, MapStage<Stage, F>> map(F f) const
+        {
+            return { source, MapStage<Stage, F>{ stage, std::move(f) } };
+        }
+
+        //Lazily drops the items of the view for which |predicate| is false
+        template <typename F>
+        View<T, Policy, Out, FilterStage<Stage, F>> filter(F predicate) const
+        {
+            return { source, FilterStage<Stage, F>{ stage, std::move(predicate) } };
+        }
+
+        //////////////// CONSUMERS
+
+        //Runs the pipeline once, calling |f| on every item produced
+        template <typename F>
+        void for_each(F f) const
+        {
+            for (const T& item : source) stage(item, f);
+        }
+
+        //Runs the pipeline once, combining the items into |accumulator| with |f(accumulator, item)|
+        template <typename A, typename F>
+        A fold(A accumulator, F f) const
+        {
+            for_each([&](const Out& value) { accumulator = f(std::move(accumulator), value); });
+
+            return accumulator;
+        }
+
+        //Runs the pipeline once, collecting the items into a new list
+        List<Out, Policy> to_list() const
+        {
+            typename List<Out, Policy>::Transient builder;
+
+            for_each([&](const Out& value) { builder.push_back(value); });
+
+            return builder.persistent();
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //keeps the source version alive while the view exists
+        List<T, Policy> source;
+
+        //every transformation fused into one callable
+        Stage stage;
+};
+
+//Starts a lazy pipeline over |list|
+template <typename T, typename Policy>
+View<T, Policy, T, IdentityStage> view(const List<T, Policy>& list)
+{
+    return { list, IdentityStage{} };
+}
+
+////////////////////////////// PARALLEL MAP REDUCE
+
+//Lists shorter than this are reduced on the calling thread
+constexpr size_t PARALLEL_THRESHOLD = 1 << 14;
+
+//Returns |reduce| over |map| of every item, starting from |identity|
+//|reduce| must be associative and |identity| must be its identity element,
+//since the list is split into contiguous chunks reduced on separate threads
+//Each chunk works on its own copies of |identity|, |map| and |reduce|, so they need to be copyable
+//but are never called concurrently on the same object
+template <typename T, typename Policy, typename A, typename M, typename R>
+A map_reduce(const List<T, Policy>& list, A identity, M map, R reduce, size_t threads = std::thread::hardware_concurrency())
+{
+    using Iterator = typename List<T, Policy>::const_iterator;
+
+    //captured by value, std::async copies it again for every task
+    auto reduce_range = [identity, map, reduce](Iterator first, Iterator last) mutable
+    {
+        A accumulator = identity;
+
+        for (; first != last; ++first) accumulator = reduce(std::move(accumulator), map(*first));
+
+        return accumulator;
+    };
+
+    size_t length = list.length();
+    threads = std::max<size_t>(1, std::min(threads, length / PARALLEL_THRESHOLD));
+
+    if (threads == 1) return reduce_range(list.begin(), list.end());
+
+    //find where each chunk starts in a single walk
+    std::vector<Iterator> bounds;
+    bounds.reserve(threads + 1);
+
+    Iterator current = list.begin();
+
+    for (size_t i = 0, chunk = 0; chunk < threads; ++current, ++i)
+    {
+        if (i == chunk * length / threads)
+        {
+            bounds.push_back(current);
+            ++chunk;
+        }
+    }
+
+    bounds.push_back(list.end());
+
+    //the calling thread takes the first chunk
+    std::vector<std::future<A>> results;
+
+    for (size_t chunk = 1; chunk < threads; ++chunk)
+        results.push_back(std::async(std::launch::async, reduce_range, bounds[chunk], bounds[chunk + 1]));
+
+    A total = reduce_range(bounds[0], bounds[1]);
+
+    for (auto& result : results) total = reduce(std::move(total), result.get());
+
+    return total;
+}
+
+}
+
+#endif //VIEW_HPP
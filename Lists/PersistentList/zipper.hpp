@@ -0,0 +1,159 @@
+/*
+ * Persistent zipper over plll::List.
+ *
+ * The elements before the focus are kept in reverse order in |before| and the
+ * focus followed by the rest in |after|. Moving, inserting, removing and
+ * replacing at the focus only touch the fronts of those two lists, so each is
+ * O(1), while every untouched element stays shared with the original list.
+ * Converting back to a List costs O(position).
+ *
+ * @author, Sean Siders, sean.siders@icloud.com
+ */
+
+#include <stdexcept>
+
+#include "list.hpp"
+
+#ifndef ZIPPER_HPP
+#define ZIPPER_HPP
+
+namespace plll {
+
+////////////////////////////// PERSISTENT ZIPPER
+
+template<typename T, typename Policy = AtomicCount>
+class Zipper
+{
+    using Seq = List<T, Policy>;
+
+    public:
+
+        //////////////// CONSTRUCTORS
+
+        //Creates a zipper over an empty list
+        Zipper() {}
+
+        //Creates a zipper focused on the first element of |list|, in O(1)
+        explicit Zipper(const Seq& list) : after(list) {}
+
+        //////////////// PUBLIC FUNCTIONS
+
+        //Returns the number of elements in the list
+        size_t length() const
+        {
+            return before.length() + after.length();
+        }
+
+        //The index of the focus, equal to length() when the focus is past the last element
+        size_t position() const
+        {
+            return before.length();
+        }
+
+        //True if the focus is on the first element
+        bool at_start() const
+        {
+            return before.is_empty();
+        }
+
+        //True if the focus is past the last element
+        bool at_end() const
+        {
+            return after.is_empty();
+        }
+
+        //Returns the element at the focus
+        //Returns nullptr if the focus is past the last element
+        ValueRef<T, Policy> focus() const
+        {
+            return after.first();
+        }
+
+        //Returns the element at the focus without touching any reference count
+        //Throws std::out_of_range if the focus is past the last element
+        const T& front() const
+        {
+            if (at_end()) throw std::out_of_range("plll::Zipper::front past the last element");
+
+            return after.front();
+        }
+
+        //Moves the focus one element towards the front
+        //If the focus is on the first element then nothing will happen
+        Zipper move_left() const
+        {
+            if (at_start()) return *this;
+
+            return Zipper(before.pop_front(), after.push_front(before.front()));
+        }
+
+        //Moves the focus one element towards the back
+        //If the focus is past the last element then nothing will happen
+        Zipper move_right() const
+        {
+            if (at_end()) return *this;
+
+            return Zipper(before.push_front(after.front()), after.pop_front());
+        }
+
+        //Moves the focus to |index| in O(distance), clamped to the end of the list
+        Zipper move_to(size_t index) const
+        {
+            Zipper zipper(*this);
+
+            while (zipper.position() > index) zipper = zipper.move_left();
+            while (zipper.position() < index && !zipper.at_end()) zipper = zipper.move_right();
+
+            return zipper;
+        }
+
+        //Inserts |data| at the focus, the new element becomes the focus
+        Zipper insert(const T& data) const
+        {
+            return Zipper(before, after.push_front(data));
+        }
+
+        //Removes the element at the focus, the element after it becomes the focus
+        //If the focus is past the last element then nothing will happen
+        Zipper remove() const
+        {
+            return Zipper(before, after.pop_front());
+        }
+
+        //Replaces the element at the focus with |data|
+        //If the focus is past the last element then nothing will happen
+        Zipper replace(const T& data) const
+        {
+            if (at_end()) return *this;
+
+            return Zipper(before, after.pop_front().push_front(data));
+        }
+
+        //Returns the whole list, rebuilding only the elements before the focus
+        Seq to_list() const
+        {
+            Seq list = after;
+
+            for (const T& item : before) list = list.push_front(item);
+
+            return list;
+        }
+
+    private:
+
+        //////////////// DATA
+
+        //the elements before the focus, nearest first
+        Seq before;
+
+        //the focus and the elements after it
+        Seq after;
+
+        //////////////// PRIVATE FUNCTIONS
+
+        Zipper(const Seq& before, const Seq& after) : before(before), after(after) {}
+};
+
+}
+
+#endif //ZIPPER_HPP